@@ -0,0 +1,174 @@
+# include "Affinity.h"
+
+/*
+ * CPU placement of the pipeline threads.
+ * A stage can be pinned by hand in the config ("Affinity producers 0-3"): all of its threads may then run
+ * on any of those CPUs, and the kernel balances them inside the set.
+ * "Affinity auto" places the stages on the CPU packages (sockets) read from /sys, so the queues' cache lines
+ * stay inside a package: dispatcher shard s runs on package s, the producer workers follow the shards
+ * (worker w goes with shard w), and the co-editors share the last package with the manager that reads
+ * everything they write. With a single package there is nothing to keep apart, so auto does nothing.
+ * Placing a thread never fails the pipeline: if the kernel refuses, the thread just floats.
+ */
+
+// Parse a CPU list like "0-3,8,10-11" (the format of the /sys cpulist files). Returns -1 if it is not one.
+int parseCpuList(const char* text, cpu_set_t* cpus) {
+    CPU_ZERO(cpus);
+    const char* next = text;
+    while (1) {
+        char* end;
+        long first = strtol(next, &end, 10);
+        if (end == next || first < 0) {
+            return -1;
+        }
+        long last = first;
+        if (*end == '-') {
+            next = end + 1;
+            last = strtol(next, &end, 10);
+            if (end == next || last < first) {
+                return -1;
+            }
+        }
+        if (last >= CPU_SETSIZE) {
+            return -1;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            CPU_SET(cpu, cpus);
+        }
+        if (*end != ',') {
+            // Only trailing white space (like the newline of a /sys file) may follow.
+            while (*end == ' ' || *end == '\t' || *end == '\n') {
+                end++;
+            }
+            return *end == '\0' ? 0 : -1;
+        }
+        next = end + 1;
+    }
+}
+
+// Read the first line of a /sys file. Returns -1 if it can't be read.
+int readSysFile(const char* path, char* line, int size) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    char* result = fgets(line, size, file);
+    fclose(file);
+    return result == NULL ? -1 : 0;
+}
+
+// Group the CPUs we may run on by their package (/sys/devices/system/cpu/cpuN/topology/physical_package_id).
+// Returns the number of packages found and puts them in placement -> packages (0 if the topology can't be read).
+int readCpuPackages(Placement* placement) {
+    char line[4096];
+    cpu_set_t online, allowed;
+    if (readSysFile("/sys/devices/system/cpu/online", line, sizeof(line)) != 0 || parseCpuList(line, &online) != 0) {
+        return 0;
+    }
+    // The CPUs this process may use (e.g. under taskset or in a cgroup).
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0) {
+        CPU_AND(&online, &online, &allowed);
+    }
+    int ids[CPU_SETSIZE];
+    placement -> packages = malloc(CPU_COUNT(&online) * sizeof(cpu_set_t));
+    if (placement -> packages == NULL) {
+        return 0;
+    }
+    int numPackages = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &online)) {
+            continue;
+        }
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+        int id = 0; // A CPU without topology goes with package 0
+        if (readSysFile(path, line, sizeof(line)) == 0) {
+            id = atoi(line);
+        }
+        int package = 0;
+        while (package < numPackages && ids[package] != id) {
+            package++;
+        }
+        if (package == numPackages) {
+            ids[numPackages] = id;
+            CPU_ZERO(&placement -> packages[numPackages]);
+            numPackages++;
+        }
+        CPU_SET(cpu, &placement -> packages[package]);
+    }
+    return numPackages;
+}
+
+// Constructor of the Placement of a pipeline with 'numShards' dispatcher shards, as the config asks for.
+Placement* constructorPlacement(Config* config, int numShards) {
+    Placement* placement = malloc(sizeof(Placement));
+    if (placement == NULL) {
+        perror("Failed to allocate memory for Placement");
+        return NULL;
+    }
+    for (int i = 0; i < NUM_THREAD_STAGES; ++i) {
+        placement -> pinned[i] = config -> StagePinned[i];
+        placement -> stageCpus[i] = config -> StageCpus[i];
+    }
+    placement -> numPackages = 0;
+    placement -> packages = NULL;
+    placement -> numShards = numShards > 0 ? numShards : 1;
+    if (config -> AutoAffinity) {
+        placement -> numPackages = readCpuPackages(placement);
+        if (placement -> numPackages < 2) {
+            placement -> numPackages = 0; // A single package: let the kernel balance
+        }
+    }
+    return placement;
+}
+
+// The CPUs thread 'index' of 'stage' should run on. Returns 0 if it may run anywhere.
+int stageCpus(Placement* placement, ThreadStage stage, int index, cpu_set_t* cpus) {
+    if (placement == NULL) {
+        return 0;
+    }
+    if (placement -> pinned[stage]) {
+        *cpus = placement -> stageCpus[stage];
+        return 1;
+    }
+    if (placement -> numPackages == 0) {
+        return 0;
+    }
+    int package;
+    switch (stage) {
+        case STAGE_DISPATCHERS:
+            package = index % placement -> numPackages;
+            break;
+        case STAGE_PRODUCERS:
+            // The tasks move between the workers, so the workers are spread over the packages like the shards.
+            package = (index % placement -> numShards) % placement -> numPackages;
+            break;
+        default:
+            // The co-editors and the manager around the shared buffer.
+            package = placement -> numPackages - 1;
+            break;
+    }
+    *cpus = placement -> packages[package];
+    return 1;
+}
+
+// Pin 'thread', thread 'index' of 'stage', to its CPUs (if it has any).
+void placeThread(Placement* placement, ThreadStage stage, int index, pthread_t thread) {
+    cpu_set_t cpus;
+    if (!stageCpus(placement, stage, index, &cpus)) {
+        return;
+    }
+    int error = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpus);
+    if (error != 0) {
+        fprintf(stderr, "Failed to set the CPU affinity of a thread: %s\n", strerror(error));
+    }
+}
+
+// Destructor for Placement.
+void destructorPlacement(Placement* placement) {
+    if (placement == NULL) {
+        return;
+    }
+    free(placement -> packages);
+    free(placement);
+}
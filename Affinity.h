@@ -0,0 +1,12 @@
+#pragma once
+#ifndef TASK3_AFFINITY_H
+#define TASK3_AFFINITY_H
+#include "Structs.h"
+int parseCpuList(const char* text, cpu_set_t* cpus);
+int readSysFile(const char* path, char* line, int size);
+int readCpuPackages(Placement* placement);
+Placement* constructorPlacement(Config* config, int numShards);
+int stageCpus(Placement* placement, ThreadStage stage, int index, cpu_set_t* cpus);
+void placeThread(Placement* placement, ThreadStage stage, int index, pthread_t thread);
+void destructorPlacement(Placement* placement);
+#endif //TASK3_AFFINITY_H
@@ -0,0 +1,197 @@
+# include "ArticlePool.h"
+#include <stddef.h>
+
+/*
+ * Every producer allocates its articles from its own pool, and the manager gives them back when it is done.
+ * The producer hands out blocks from 'freeList' (no locking, only the producer touches it).
+ * The manager pushes blocks to 'returned', a lock-free stack. When 'freeList' is empty the producer takes
+ * the whole 'returned' stack at once (atomic exchange), so we never pop a single node and there is no ABA problem.
+ * A new slab is malloc'ed only when both are empty, so once the pipeline is warmed up there are no more mallocs.
+ *
+ * A pool with a limit never mallocs more than 'limit' articles: those are the producer's credits.
+ * When all of them are in flight tryAllocateArticle returns NULL, the producer arms the pool and parks,
+ * and the first releaseArticle that sees 'ownerWaiting' wakes it. So a slow downstream slows the producers
+ * down instead of making the memory grow.
+ */
+
+// Malloc a slab of 'count' blocks (or take it from the pool's arena) and put all of them in the free list.
+void addArticleSlab(ArticlePool* pool, int count) {
+    size_t size = sizeof(ArticleSlab) + count * sizeof(ArticleBlock);
+    ArticleSlab* slab = pool -> arena != NULL ? allocateSharedArena(pool -> arena, size) : malloc(size);
+    if (slab == NULL) {
+        perror("Failed to allocate memory for articles");
+        exit(-1);
+    }
+    slab -> count = count;
+    slab -> next = pool -> slabs;
+    pool -> slabs = slab;
+    for (int i = 0; i < count; ++i) {
+        slab -> blocks[i].pool = pool;
+        slab -> blocks[i].next = pool -> freeList;
+        pool -> freeList = &slab -> blocks[i];
+    }
+    pool -> stats.slabs += 1;
+    pool -> stats.capacity += count;
+}
+
+// Constructor of an Article Pool for a producer that creates 'numArticles' articles.
+ArticlePool* constructorArticlePool(int numArticles) {
+    return constructorLimitedArticlePool(numArticles, 0);
+}
+
+// Constructor of an Article Pool that never holds more than 'limit' articles (0 = no limit).
+ArticlePool* constructorLimitedArticlePool(int numArticles, int limit) {
+    ArticlePool* pool = aligned_alloc(CACHE_LINE_SIZE, sizeof(ArticlePool));
+    if (pool == NULL) {
+        perror("Failed to allocate memory for ArticlePool");
+        return NULL;
+    }
+    initArticlePool(pool, numArticles, limit, NULL);
+    return pool;
+}
+
+// Constructor of an Article Pool in shared memory, for an owner in another process (the pool and its slabs
+// come from 'arena'). It gets a limit, since a process can't grow the arena: it never needs a second slab.
+ArticlePool* constructorSharedArticlePool(int numArticles, int limit, SharedArena* arena) {
+    ArticlePool* pool = allocateSharedArena(arena, sizeof(ArticlePool));
+    if (pool == NULL) {
+        fprintf(stderr, "The shared memory segment is full\n");
+        return NULL;
+    }
+    initArticlePool(pool, numArticles, articlePoolFirstSlab(numArticles, limit), arena);
+    return pool;
+}
+
+// The size of the first slab of a pool: all the articles of the producer, but not more than
+// ARTICLE_POOL_MAX_SLAB (a huge producer will reuse the articles that come back instead) or its limit.
+int articlePoolFirstSlab(int numArticles, int limit) {
+    int firstSlab = numArticles < 1 ? 1 : numArticles;
+    if (firstSlab > ARTICLE_POOL_MAX_SLAB) {
+        firstSlab = ARTICLE_POOL_MAX_SLAB;
+    }
+    if (limit > 0 && firstSlab > limit) {
+        firstSlab = limit;
+    }
+    return firstSlab;
+}
+
+// Initialize a pool in memory the caller gave and add its first slab.
+void initArticlePool(ArticlePool* pool, int numArticles, int limit, SharedArena* arena) {
+    pool -> freeList = NULL;
+    pool -> slabs = NULL;
+    memset(&pool -> stats, 0, sizeof(ArticlePoolStats));
+    pool -> arena = arena;
+    pool -> limit = limit > 0 ? limit : 0;
+    pool -> ownerWakeup = NULL;
+    pool -> ownerWakeupArg = NULL;
+    atomic_init(&pool -> returned, NULL);
+    atomic_init(&pool -> ownerWaiting, 0);
+    // Size the first slab so the producer never has to malloc again.
+    int firstSlab = articlePoolFirstSlab(numArticles, pool -> limit);
+    addArticleSlab(pool, firstSlab);
+    // Next slabs (if ever needed) are smaller, they only cover articles that are still in flight.
+    pool -> slabSize = firstSlab < 64 ? firstSlab : 64;
+}
+
+// Take an article from the pool. Must only be called by the owner of the pool (the producer).
+// Returns NULL only if the pool has a limit and all its articles are in flight.
+Article* tryAllocateArticle(ArticlePool* pool) {
+    if (pool -> freeList == NULL) {
+        // Take back everything that was returned so far.
+        ArticleBlock* returned = atomic_exchange_explicit(&pool -> returned, NULL, memory_order_acquire);
+        while (returned != NULL) {
+            ArticleBlock* next = returned -> next;
+            returned -> next = pool -> freeList;
+            pool -> freeList = returned;
+            pool -> stats.returns += 1;
+            returned = next;
+        }
+    }
+    if (pool -> freeList == NULL) {
+        long count = pool -> slabSize;
+        if (pool -> limit > 0 && count > pool -> limit - pool -> stats.capacity) {
+            count = pool -> limit - pool -> stats.capacity;
+        }
+        if (count == 0) {
+            return NULL; // Out of credits
+        }
+        addArticleSlab(pool, (int)count);
+    }
+    ArticleBlock* block = pool -> freeList;
+    pool -> freeList = block -> next;
+    pool -> stats.allocations += 1;
+    return &block -> article;
+}
+
+// Take an article from a pool without a limit (it never returns NULL).
+Article* allocateArticle(ArticlePool* pool) {
+    return tryAllocateArticle(pool);
+}
+
+/*
+ * Called by the owner after tryAllocateArticle returned NULL, before it parks.
+ * Returns 1 if ownerWakeup will be called when an article comes back,
+ * or 0 if articles were already returned meanwhile (the owner should try again instead of parking).
+ */
+int armArticlePool(ArticlePool* pool) {
+    atomic_store(&pool -> ownerWaiting, 1);
+    // Pairs with the fence in releaseArticle: either we see the returned article, or it sees ownerWaiting.
+    if (atomic_load(&pool -> returned) == NULL) {
+        return 1;
+    }
+    // Already returned. If the releaser took the flag first it calls ownerWakeup, so we are armed anyway.
+    return atomic_exchange(&pool -> ownerWaiting, 0) == 0;
+}
+
+// Give an article back to the pool it came from. May be called by any thread.
+void releaseArticle(Article* article) {
+    ArticleBlock* block = (ArticleBlock*)((char*)article - offsetof(ArticleBlock, article));
+    ArticlePool* pool = block -> pool;
+    ArticleBlock* head = atomic_load_explicit(&pool -> returned, memory_order_relaxed);
+    do {
+        block -> next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&pool -> returned, &head, block,
+                                                    memory_order_release, memory_order_relaxed));
+    if (pool -> limit > 0) {
+        // Only a pool with a limit can run dry, so only then does the owner wait for us.
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&pool -> ownerWaiting, memory_order_relaxed) &&
+            atomic_exchange(&pool -> ownerWaiting, 0) == 1 && pool -> ownerWakeup != NULL) {
+            pool -> ownerWakeup(pool -> ownerWakeupArg);
+        }
+    }
+}
+
+// Copy the statistics of a pool. Only accurate when the owner is not running (e.g after it was joined).
+void getArticlePoolStats(ArticlePool* pool, ArticlePoolStats* stats) {
+    *stats = pool -> stats;
+}
+
+// Print the statistics of all the producers pools together.
+void printArticlePoolStats(Producer** producers, int numProducers, FILE* file) {
+    ArticlePoolStats total = {0};
+    for (int i = 0; i < numProducers; ++i) {
+        ArticlePoolStats stats;
+        getArticlePoolStats(producers[i] -> pool, &stats);
+        total.slabs += stats.slabs;
+        total.capacity += stats.capacity;
+        total.allocations += stats.allocations;
+        total.returns += stats.returns;
+    }
+    fprintf(file, "Article pools: %ld articles allocated, %ld reused after return, %ld mallocs (%ld articles of memory)\n",
+            total.allocations, total.returns, total.slabs, total.capacity);
+}
+
+// Destructor for ArticlePool. All the articles must have been returned (or never be used again).
+void destructorArticlePool(ArticlePool* pool) {
+    if (pool == NULL || pool -> arena != NULL) {
+        return; // The arena owns the memory of a shared pool
+    }
+    ArticleSlab* slab = pool -> slabs;
+    while (slab != NULL) {
+        ArticleSlab* next = slab -> next;
+        free(slab);
+        slab = next;
+    }
+    free(pool);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#ifndef TASK3_ARTICLEPOOL_H
+#define TASK3_ARTICLEPOOL_H
+#include "Structs.h"
+// The first slab of a pool holds all the articles of the producer, but not more than this.
+#define ARTICLE_POOL_MAX_SLAB 4096
+ArticlePool* constructorArticlePool(int numArticles);
+ArticlePool* constructorLimitedArticlePool(int numArticles, int limit);
+ArticlePool* constructorSharedArticlePool(int numArticles, int limit, SharedArena* arena);
+int articlePoolFirstSlab(int numArticles, int limit);
+void initArticlePool(ArticlePool* pool, int numArticles, int limit, SharedArena* arena);
+Article* tryAllocateArticle(ArticlePool* pool);
+Article* allocateArticle(ArticlePool* pool);
+int armArticlePool(ArticlePool* pool);
+void releaseArticle(Article* article);
+void getArticlePoolStats(ArticlePool* pool, ArticlePoolStats* stats);
+void printArticlePoolStats(Producer** producers, int numProducers, FILE* file);
+void destructorArticlePool(ArticlePool* pool);
+#endif //TASK3_ARTICLEPOOL_H
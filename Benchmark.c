@@ -0,0 +1,175 @@
+#include "Structs.h"
+#include <fcntl.h>
+
+/*
+ * Benchmarks (built as bench.out, not part of ex3.out).
+ * Usage: bench.out [producers] [articles per producer] [queue length] [edit delay usec] [co-editors per type] [max threads]
+ * 1. Runs the whole pipeline on a generated config and prints articles/s and the end to end latency percentiles.
+ * 2. Runs every Queue.c buffer alone with 1..max threads writing to it and one thread reading, and prints articles/s.
+ */
+
+// Total number of articles moved through a buffer in one queue benchmark.
+#define QUEUE_BENCH_ARTICLES 1000000
+// Size of the bounded buffers in the queue benchmarks.
+#define QUEUE_BENCH_SIZE 1024
+// Batch size used by the batch variants of the queue benchmarks.
+#define QUEUE_BENCH_BATCH 16
+
+// The value below which 'fraction' of the latencies are, in milliseconds.
+double percentileMs(Histogram* latencies, double fraction) {
+    return histogramPercentile(latencies, fraction) / 1e6;
+}
+
+// Write a config file with 'producers' producers and return its parsed Config (NULL on error).
+Config* generateConfig(int producers, int articles, int queueLength, int editDelayUsec, int coEditors) {
+    char path[] = "/tmp/task3_benchXXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        perror("Failed to create the benchmark config");
+        return NULL;
+    }
+    FILE* file = fdopen(fd, "w");
+    for (int i = 1; i <= producers; ++i) {
+        fprintf(file, "%d\n%d\n%d\n\n", i, articles, queueLength);
+    }
+    fprintf(file, "%d\n\nEditDelay %d\nCoEditors %d\n", queueLength, editDelayUsec, coEditors);
+    fclose(file);
+    Config* config = processConfig(path);
+    unlink(path);
+    return config;
+}
+
+// Run the whole pipeline once and print its throughput and latency.
+void benchmarkPipeline(int producers, int articles, int queueLength, int editDelayUsec, int coEditors) {
+    Config* config = generateConfig(producers, articles, queueLength, editDelayUsec, coEditors);
+    if (config == NULL) {
+        exit(1);
+    }
+    Histogram* latencies = constructorHistogram();
+    // The manager writes to stdout, send that to /dev/null while we measure.
+    fflush(stdout);
+    int savedStdout = dup(STDOUT_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    long long start = getMonotonicNs();
+    runPipeline(config, latencies);
+    long long elapsed = getMonotonicNs() - start;
+    dup2(savedStdout, STDOUT_FILENO);
+    close(devNull);
+    close(savedStdout);
+
+    printf("pipeline: %d producers x %d articles, queue %d, edit delay %d us, %d co-editors per type\n",
+           producers, articles, queueLength, editDelayUsec, coEditors);
+    printf("  %.0f articles/s, latency p50 %.3f ms, p99 %.3f ms, p99.9 %.3f ms\n",
+           latencies -> total / (elapsed / 1e9), percentileMs(latencies, 0.5), percentileMs(latencies, 0.99),
+           percentileMs(latencies, 0.999));
+    destructorHistogram(latencies);
+}
+
+typedef struct {
+    BoundedBuffer* bounded; // One of them is used
+    UnboundedBuffer* unbounded;
+    int count; // Number of articles to move
+    int batch; // 1 = the single article functions
+} QueueBenchArgs;
+
+// Any article will do, the buffers only move pointers.
+Article benchArticle;
+
+void* queueBenchWriter(void* arg) {
+    QueueBenchArgs* args = (QueueBenchArgs*)arg;
+    Article* articles[QUEUE_BENCH_BATCH];
+    for (int i = 0; i < QUEUE_BENCH_BATCH; ++i) {
+        articles[i] = &benchArticle;
+    }
+    for (int i = 0; i < args -> count; i += args -> batch) {
+        int n = args -> count - i < args -> batch ? args -> count - i : args -> batch;
+        if (args -> bounded != NULL) {
+            if (args -> batch == 1) {
+                insertBoundedBuffer(args -> bounded, articles[0]);
+            } else {
+                insertBoundedBufferBatch(args -> bounded, articles, n);
+            }
+        } else {
+            if (args -> batch == 1) {
+                insertUnboundedBuffer(args -> unbounded, articles[0]);
+            } else {
+                insertUnboundedBufferBatch(args -> unbounded, articles, n);
+            }
+        }
+    }
+    return NULL;
+}
+
+void* queueBenchReader(void* arg) {
+    QueueBenchArgs* args = (QueueBenchArgs*)arg;
+    Article* articles[QUEUE_BENCH_BATCH];
+    int removed = 0;
+    while (removed < args -> count) {
+        int max = args -> count - removed < args -> batch ? args -> count - removed : args -> batch;
+        if (args -> bounded != NULL) {
+            removed += removeBoundedBufferBatch(args -> bounded, articles, max);
+        } else {
+            removed += removeUnboundedBufferBatch(args -> unbounded, articles, max);
+        }
+    }
+    return NULL;
+}
+
+// Move QUEUE_BENCH_ARTICLES articles through a buffer with 'writers' writer threads and one reader, print articles/s.
+void benchmarkQueue(const char* name, BoundedBuffer* bounded, UnboundedBuffer* unbounded, int writers, int batch) {
+    pthread_t threads[writers + 1];
+    QueueBenchArgs writerArgs = {bounded, unbounded, QUEUE_BENCH_ARTICLES / writers, batch};
+    QueueBenchArgs readerArgs = {bounded, unbounded, writerArgs.count * writers, batch};
+    long long start = getMonotonicNs();
+    pthread_create(&threads[writers], NULL, queueBenchReader, &readerArgs);
+    for (int i = 0; i < writers; ++i) {
+        pthread_create(&threads[i], NULL, queueBenchWriter, &writerArgs);
+    }
+    for (int i = 0; i <= writers; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    long long elapsed = getMonotonicNs() - start;
+    printf("  %-24s writers %2d batch %2d: %12.0f articles/s\n", name, writers, batch,
+           readerArgs.count / (elapsed / 1e9));
+}
+
+// Run the queue benchmarks of every buffer kind with 1..maxThreads writers.
+void benchmarkQueues(int maxThreads) {
+    printf("queues: %d articles, one reader\n", QUEUE_BENCH_ARTICLES);
+    int batches[2] = {1, QUEUE_BENCH_BATCH};
+    for (int b = 0; b < 2; ++b) {
+        // The SPSC ring only allows a single writer.
+        BoundedBuffer* spsc = constructorSpscBoundedBuffer(QUEUE_BENCH_SIZE);
+        benchmarkQueue("BoundedBuffer (SPSC)", spsc, NULL, 1, batches[b]);
+        destructorBoundedBuffer(spsc);
+        for (int writers = 1; writers <= maxThreads; ++writers) {
+            BoundedBuffer* locked = constructorBoundedBuffer(QUEUE_BENCH_SIZE);
+            benchmarkQueue("BoundedBuffer (locked)", locked, NULL, writers, batches[b]);
+            destructorBoundedBuffer(locked);
+            BoundedBuffer* mpsc = constructorMpscBoundedBuffer(QUEUE_BENCH_SIZE);
+            benchmarkQueue("BoundedBuffer (MPSC)", mpsc, NULL, writers, batches[b]);
+            destructorBoundedBuffer(mpsc);
+            UnboundedBuffer* unbounded = constructorUnboundedBuffer();
+            benchmarkQueue("UnboundedBuffer", NULL, unbounded, writers, batches[b]);
+            destructorUnboundedBuffer(unbounded);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int producers = argc > 1 ? atoi(argv[1]) : 8;
+    int articles = argc > 2 ? atoi(argv[2]) : 20000;
+    int queueLength = argc > 3 ? atoi(argv[3]) : 64;
+    int editDelayUsec = argc > 4 ? atoi(argv[4]) : 0;
+    int coEditors = argc > 5 ? atoi(argv[5]) : 1;
+    int maxThreads = argc > 6 ? atoi(argv[6]) : 4;
+    if (producers < 1 || articles < 1 || queueLength < 1 || editDelayUsec < 0 || coEditors < 1 || maxThreads < 1) {
+        fprintf(stderr, "Usage: %s [producers] [articles per producer] [queue length] [edit delay usec] "
+                        "[co-editors per type] [max threads]\n", argv[0]);
+        return 1;
+    }
+    benchmarkPipeline(producers, articles, queueLength, editDelayUsec, coEditors);
+    benchmarkQueues(maxThreads);
+    return 0;
+}
@@ -1,21 +1,173 @@
 # include "CoEditor.h"
+#include <errno.h>
+
+// The dispatcher sends a single "DONE" per type. Every thread of the type that sees it passes it on
+// to the next one, and the last one forwards it to the manager.
+void forwardCoEditorDone(CoEditor* args, Article* done) {
+    if (atomic_fetch_sub(&args -> workersLeft, 1) == 1) {
+        insertBoundedBuffer(args -> SharedBuffer, done); // Forward the "DONE" message
+    } else {
+        insertUnboundedBuffer(args -> dispatcherBuffer, done);
+    }
+}
+
+// Edit 'count' articles, one after the other.
+void editArticles(CoEditor* args, Article** articles, int count) {
+    // Without a delay editing takes no time, so a single clock read covers the whole batch.
+    long long now = args -> tracing ? getMonotonicNs() : 0;
+    for (int i = 0; i < count; ++i) {
+        if (args -> tracing) {
+            articles[i] -> stamps[STAMP_EDIT_START] = now;
+        }
+        // Simulate editing by waiting (0.1 seconds unless the config says otherwise)
+        if (args -> editDelayUsec > 0) {
+            usleep(args -> editDelayUsec);
+            now = args -> tracing ? getMonotonicNs() : 0;
+        }
+        if (args -> tracing) {
+            articles[i] -> stamps[STAMP_EDIT_END] = now;
+        }
+    }
+}
 
 void* coEditorThread(void* arg) {
     CoEditor* args = (CoEditor*)arg;
     UnboundedBuffer* dispatcherBuffer = args -> dispatcherBuffer;
     BoundedBuffer* SharedBuffer = args -> SharedBuffer;
+    STATS_THREAD_START(types[args -> type], args -> type);
 
-    char* message;
+    Article* articles[COEDITOR_BATCH];
+    int done = 0;
     do {
-        message = removeUnboundedBuffer(dispatcherBuffer);
-        if (strcmp(message, "DONE") == 0) {
-            insertBoundedBuffer(SharedBuffer, "DONE"); // Forward the "DONE" message
-        } else {
-            // Simulate editing by waiting for 0.1 seconds
-            usleep(100000);
-            insertBoundedBuffer(SharedBuffer, message); // Forward the message to the manager
+        int count = removeUnboundedBufferBatch(dispatcherBuffer, articles, args -> batchSize);
+        // "DONE" is the last thing in the queue, so it can only be the last article we got.
+        done = isDoneArticle(articles[count - 1]);
+        int numArticles = done ? count - 1 : count;
+        editArticles(args, articles, numArticles);
+        insertBoundedBufferBatch(SharedBuffer, articles, numArticles); // Forward the articles to the manager
+        if (done) {
+            forwardCoEditorDone(args, articles[count - 1]);
         }
-    } while(strcmp(message, "DONE") != 0);
+    } while(!done);
+    STATS_THREAD_END();
 
     return NULL;
 }
+
+/*
+ * Async co-editor: instead of sleeping through every edit, a thread keeps up to 'maxInFlight' edits in flight.
+ * An edit starts when the article is taken from the queue and is done 'editDelayUsec' later.
+ * All the edits of a thread take the same time, so the edits in flight are already sorted by deadline
+ * in the order they started: a ring of (article, deadline) is our timer queue, its head is the next timer.
+ * The thread waits for new articles only until that deadline, and sleeps until it when the ring is full.
+ */
+void* asyncCoEditorThread(void* arg) {
+    CoEditor* args = (CoEditor*)arg;
+    STATS_THREAD_START(types[args -> type], args -> type);
+    int max = args -> maxInFlight;
+    Article** inFlight = malloc(max * sizeof(Article*));
+    long long* deadlines = malloc(max * sizeof(long long));
+    if (inFlight == NULL || deadlines == NULL) {
+        perror("Failed to allocate memory for the async co-editor");
+        exit(-1);
+    }
+    long long delayNs = args -> editDelayUsec * 1000LL;
+    int head = 0;
+    int count = 0;
+    Article* done = NULL;
+    Article* articles[COEDITOR_BATCH];
+    while (done == NULL || count > 0) {
+        long long nextDeadline = count > 0 ? deadlines[head] : 0;
+        if (done == NULL && count < max) {
+            // Start new edits (wait for them only until the oldest edit in flight is done).
+            int room = max - count < COEDITOR_BATCH ? max - count : COEDITOR_BATCH;
+            int taken = removeUnboundedBufferBatchUntil(args -> dispatcherBuffer, articles, room, nextDeadline);
+            if (taken > 0 && isDoneArticle(articles[taken - 1])) {
+                // "DONE" is the last thing in the queue, it is passed on when all our edits are done.
+                done = articles[--taken];
+            }
+            long long now = getMonotonicNs();
+            for (int i = 0; i < taken; ++i) {
+                if (args -> tracing) {
+                    articles[i] -> stamps[STAMP_EDIT_START] = now;
+                }
+                int slot = (head + count) % max;
+                inFlight[slot] = articles[i];
+                deadlines[slot] = now + delayNs;
+                count++;
+            }
+        } else if (count > 0) {
+            // Nothing to start: sleep until the oldest edit is done.
+            struct timespec deadline = {nextDeadline / 1000000000LL, nextDeadline % 1000000000LL};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+            }
+        }
+        // Forward every edit whose time is up, a batch at a time.
+        long long now = getMonotonicNs();
+        while (count > 0 && deadlines[head] <= now) {
+            int finished = 0;
+            while (finished < COEDITOR_BATCH && count > 0 && deadlines[head] <= now) {
+                articles[finished] = inFlight[head];
+                if (args -> tracing) {
+                    articles[finished] -> stamps[STAMP_EDIT_END] = now;
+                }
+                finished++;
+                head = (head + 1) % max;
+                count--;
+            }
+            insertBoundedBufferBatch(args -> SharedBuffer, articles, finished); // Forward the articles to the manager
+        }
+    }
+    forwardCoEditorDone(args, done);
+    free(inFlight);
+    free(deadlines);
+    STATS_THREAD_END();
+    return NULL;
+}
+
+/*
+ * Direct routing: there is no dispatcher, every producer has a lane (SPSC ring) per type.
+ * The lanes of a type are split between the threads of that type, so every lane still has a single reader.
+ * A thread sleeps on its ready set, where a producer marks its lane when it inserts to it, and then takes from
+ * the marked lanes only, the same way a dispatcher shard reads its producers.
+ * A thread is done once all its lanes sent "DONE", and the last thread of the type tells the manager.
+ */
+void* directCoEditorThread(void* arg) {
+    CoEditorLanes* lanes = (CoEditorLanes*)arg;
+    CoEditor* args = lanes -> coEditor;
+    STATS_THREAD_START(types[args -> type], lanes -> index);
+    Article* articles[COEDITOR_BATCH];
+    while (lanes -> doneCount < lanes -> numLanes) {
+        // Sleep until some producer marked one of our lanes
+        waitReadySet(&lanes -> ready, args -> dispatcherBuffer -> waitStrategy);
+        int numReady = takeReadySet(&lanes -> ready, lanes -> readyMembers);
+        for (int j = 0; j < numReady; ++j) {
+            int i = lanes -> readyMembers[j];
+            if (lanes -> laneDone[i]) {
+                continue;
+            }
+            clearReadyBuffer(lanes -> lanes[i]);
+            int count = tryRemoveBoundedBufferBatch(lanes -> lanes[i], articles, args -> batchSize);
+            if (count == args -> batchSize) {
+                markReadySet(&lanes -> ready, i); // It may have more, visit it again after the others
+            }
+            // "DONE" is the last thing a producer inserts, so it can only be the last article we got.
+            if (count > 0 && isDoneArticle(articles[count - 1])) {
+                lanes -> laneDone[i] = 1;
+                lanes -> doneCount++;
+                count--;
+            }
+            if (args -> tracing && count > 0) {
+                // No dispatcher hop: the article is "dispatched" when we take it.
+                stampArticles(articles, count, STAMP_DISPATCHED, getMonotonicNs());
+            }
+            editArticles(args, articles, count);
+            insertBoundedBufferBatch(args -> SharedBuffer, articles, count); // Forward the articles to the manager
+        }
+    }
+    if (atomic_fetch_sub(&args -> workersLeft, 1) == 1) {
+        insertBoundedBuffer(args -> SharedBuffer, &DoneArticle); // Forward the "DONE" message
+    }
+    STATS_THREAD_END();
+    return NULL;
+}
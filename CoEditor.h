@@ -2,5 +2,14 @@
 #ifndef TASK3_COEDITOR_H
 #define TASK3_COEDITOR_H
 #include "Structs.h"
+// How long editing an article takes (unless the config says otherwise).
+#define EDIT_DELAY_USEC 100000
+// Max number of articles a co-editor takes from its queue at once. Only used when editing takes no time,
+// otherwise one thread would hold articles its idle siblings could be editing.
+#define COEDITOR_BATCH 16
+void forwardCoEditorDone(CoEditor* args, Article* done);
 void* coEditorThread(void* arg);
+void* asyncCoEditorThread(void* arg);
+void editArticles(CoEditor* args, Article** articles, int count);
+void* directCoEditorThread(void* arg);
 #endif //TASK3_COEDITOR_H
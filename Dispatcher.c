@@ -1,71 +1,119 @@
 # include "Dispatcher.h"
 
-// This function processes a "DONE" message from a producer. It cleans up the producer and increments the done_count.
-// If all producers are done, it sends "DONE" through each dispatcher's queue.
-void processDoneMessage(Dispatcher* dispatcher, int producerIndex, int* done_count) {
-    // Terminate and clean up this producer
-    destructorBoundedBuffer(dispatcher -> producers[producerIndex] -> ProducerBuffer);
-    free(dispatcher -> producers[producerIndex]); // Free the producer struct
-    dispatcher -> producers[producerIndex] = NULL; // Set the pointer in the producers array to NULL
+/*
+ * With "Dispatchers K" in the config there are K dispatcher threads. Each one owns a contiguous slice (shard)
+ * of the producers: it is the only reader of their buffers and sleeps on its own ready set, so the shards
+ * share nothing but the per-type queues (which have a lock for their many writers anyway).
+ * A producer is read by a single shard, so its articles still reach its type's queue in order.
+ */
 
-    // Increment the counter how much times we saw done. in the third time it will
-    (*done_count)++;
-
-    // All producers are done, send "DONE" through each dispatcher's queue and exit loop
-    if (*done_count == (dispatcher -> TotalNumProducers)) {
-        for (int j = 0; j < NUM_ARTICLES_TYPES; ++j) {
-            insertUnboundedBuffer(dispatcher->DispatcherBuffersArray[j], "DONE");
+// All the producers of this shard are done. If the other shards are done too, send "DONE" through
+// each dispatcher's queue (only the last shard does, so the co-editors get a single "DONE" per type).
+void finishDispatcherShard(DispatcherShard* shard) {
+    Dispatcher* dispatcher = shard -> dispatcher;
+    if (atomic_fetch_sub(&dispatcher -> shardsRunning, 1) == 1) {
+        for (int j = 0; j < numArticleTypes; ++j) {
+            insertUnboundedBuffer(dispatcher->DispatcherBuffersArray[j], &DoneArticle);
         }
     }
 }
 
-int checkTypeArticle(char* message) {
-    if (strstr(message, "Sports") != NULL) {
-        return 0;
-    } else if (strstr(message, "News") != NULL) {
-        return 1;
-    } else if (strstr(message, "Weather") != NULL) {
-        return 2;
+// This function processes a "DONE" message from a producer. It marks the producer as done and increments the shard's doneCount.
+// When the last producer of the last running shard is done, it sends "DONE" through each dispatcher's queue.
+void processDoneMessage(DispatcherShard* shard, int producerIndex) {
+    Dispatcher* dispatcher = shard -> dispatcher;
+    // Stop reading from this producer. Its buffer is freed only after the threads are joined (FreeResources),
+    // the producer may still be touching it right after it published the "DONE".
+    dispatcher -> producers[producerIndex] -> isDone = 1;
+
+    // Increment the counter how much times we saw done (only this shard's thread touches it).
+    shard -> doneCount++;
+
+    if (shard -> doneCount == shard -> count) {
+        finishDispatcherShard(shard);
+    }
+}
+// This function sends normal articles from a producer to the appropriate dispatcher's queues (for the co-editor usage).
+// The producer already wrote the type of each article (its index in the queues), so there is nothing to parse.
+// The articles are grouped by type so every queue is locked once. Only the types in the batch are touched,
+// so the cost doesn't depend on the number of types.
+void sendToCoEditors(DispatcherShard* shard, Article** articles, int count) {
+    Dispatcher* dispatcher = shard -> dispatcher;
+    int numBatchTypes = 0;
+    for (int i = 0; i < count; ++i) {
+        int type = articles[i] -> type;
+        if (type < 0 || type >= numArticleTypes) {
+            perror("Invalid Message Type");
+            exit(-1);
+        }
+        if (shard -> typeCounts[type] == 0) {
+            // A new type in this batch: keep them sorted by urgency (at most DISPATCHER_BATCH of them)
+            int j = numBatchTypes++;
+            while (j > 0 && dispatcher -> typeRanks[shard -> batchTypes[j - 1]] > dispatcher -> typeRanks[type]) {
+                shard -> batchTypes[j] = shard -> batchTypes[j - 1];
+                j--;
+            }
+            shard -> batchTypes[j] = type;
+        }
+        shard -> byType[type * DISPATCHER_BATCH + shard -> typeCounts[type]++] = articles[i];
+    }
+    if (dispatcher -> tracing) {
+        stampArticles(articles, count, STAMP_DISPATCHED, getMonotonicNs());
+    }
+    // Insert the articles into the appropriate dispatcher's queues, the most urgent type first
+    for (int i = 0; i < numBatchTypes; ++i) {
+        int type = shard -> batchTypes[i];
+        insertUnboundedBufferBatch(dispatcher -> DispatcherBuffersArray[type], &shard -> byType[type * DISPATCHER_BATCH],
+                                   shard -> typeCounts[type]);
+        shard -> typeCounts[type] = 0;
     }
-    return -1; // error, unknown type
 }
 
-// This function processes a normal message from a producer. It parses the message to determine its type,
-// then inserts the message into the appropriate dispatcher's queue (for the co-editor usage).
-void sendToCoEditor(Dispatcher* dispatcher, char* message) {
-    int type_index = checkTypeArticle(message);
-    if (type_index == -1) {
-        perror("Invalid Message Type");
-        exit(-1);
+// Take up to DISPATCHER_BATCH articles from a single producer without blocking.
+// Returns how many articles were taken out of the producer's buffer (the "DONE" message included).
+int drainProducer(DispatcherShard* shard, int producerIndex) {
+    Dispatcher* dispatcher = shard -> dispatcher;
+    Article* articles[DISPATCHER_BATCH];
+    int count = tryRemoveBoundedBufferBatch(dispatcher -> producers[producerIndex] -> ProducerBuffer,
+                                            articles, DISPATCHER_BATCH);
+    // "DONE" is the last thing a producer inserts, so it can only be the last article we got.
+    int sawDone = count > 0 && isDoneArticle(articles[count - 1]);
+    sendToCoEditors(shard, articles, sawDone ? count - 1 : count);
+    if (sawDone) {
+        processDoneMessage(shard, producerIndex);
     }
-    // Insert the message into the appropriate dispatcher's queue
-    insertUnboundedBuffer(dispatcher -> DispatcherBuffersArray[type_index], message);
+    return count;
 }
 
+// Instead of blocking on each producer in turn (one slow producer would stall all the others),
+// a dispatcher thread sleeps on its shard's ready set. A producer marks its buffer there when it inserts to it
+// and it isn't marked yet, so when we wake up we only visit the producers that have data, not all of them.
 void* dispatcherThread(void* arg) {
-    Dispatcher* dispatcher = (Dispatcher*)arg;
-    int done_count = 0;
-    while (1) {
-        if(dispatcher == NULL) {
-            perror("Dispatcher is NULL\n");
-            exit(-1);
-        }
-        for (int i = 0; i < dispatcher -> TotalNumProducers; ++i) {
-            if (dispatcher -> producers[i] != NULL) { // If this producer hasn't been terminated
-                char* message = removeBoundedBuffer(dispatcher -> producers[i]-> ProducerBuffer); // Read news from the producer
-                if (message != NULL) {
-                    if (strcmp(message, "DONE") == 0) {
-                        processDoneMessage(dispatcher, i, &done_count);
-                        if (done_count == (dispatcher -> TotalNumProducers)) {
-                            return NULL; // Exit the dispatcher thread
-                        }
-                    } else {
-                        sendToCoEditor(dispatcher, message);
-                    }
-                }
-                // If message is NULL, continue to the next producer's buffer without processing a message
+    DispatcherShard* shard = (DispatcherShard*)arg;
+    if(shard == NULL) {
+        perror("Dispatcher is NULL\n");
+        exit(-1);
+    }
+    Dispatcher* dispatcher = shard -> dispatcher;
+    STATS_THREAD_START("dispatcher", shard -> index);
+    if (shard -> count == 0) {
+        finishDispatcherShard(shard); // No producers at all
+    }
+    while (shard -> doneCount < shard -> count) {
+        waitReadySet(&shard -> ready, dispatcher -> waitStrategy); // Sleep until some producer marked its buffer
+        int numReady = takeReadySet(&shard -> ready, shard -> readyMembers);
+        for (int j = 0; j < numReady; ++j) {
+            int i = shard -> first + shard -> readyMembers[j];
+            if (dispatcher -> producers[i] -> isDone) { // If this producer has been terminated
+                continue;
+            }
+            clearReadyBuffer(dispatcher -> producers[i] -> ProducerBuffer);
+            // A full batch may have left more behind: visit it again next round (after the others had their turn).
+            if (drainProducer(shard, i) == DISPATCHER_BATCH && !dispatcher -> producers[i] -> isDone) {
+                markReadySet(&shard -> ready, shard -> readyMembers[j]);
             }
         }
     }
+    STATS_THREAD_END();
+    return NULL; // Exit the dispatcher thread
 }
-
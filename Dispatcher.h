@@ -2,5 +2,7 @@
 #ifndef TASK3_DISPATCHER_H
 #define TASK3_DISPATCHER_H
 #include "Structs.h"
+// Max number of articles taken from one producer (in one batch) before moving on to the next one.
+#define DISPATCHER_BATCH 16
 void* dispatcherThread(void* arg);
 #endif //TASK3_DISPATCHER_H
@@ -2,23 +2,61 @@
 void FreeResources(Config *config, CoEditor **ArrayCoEditors, pthread_t *coEditorThreads, Manager *manager,
                    BoundedBuffer *SharedBuffer, UnboundedBuffer **DispatcherBuffersArray, Dispatcher *dispatcher) {
     // Free ArrayCoEditors
-    for (int i = 0; i < NUM_ARTICLES_TYPES; ++i) {
+    for (int i = 0; i < numArticleTypes; ++i) {
+        if (ArrayCoEditors[i] -> lanes != NULL) {
+            for (int j = 0; j < ArrayCoEditors[i] -> numWorkers; ++j) {
+                free(ArrayCoEditors[i] -> lanes[j].lanes);
+                free(ArrayCoEditors[i] -> lanes[j].laneDone);
+                free(ArrayCoEditors[i] -> lanes[j].readyMembers);
+                destroyReadySet(&ArrayCoEditors[i] -> lanes[j].ready);
+            }
+            free(ArrayCoEditors[i] -> lanes);
+        }
         free(ArrayCoEditors[i]);
     }
     free(ArrayCoEditors);
 
     // Free coEditorThreads, manager, SharedBuffer
     free(coEditorThreads);
+    destructorOutputWriter(manager -> writer);
+    destructorJournal(manager -> journal);
+    destructorManagerLanes(manager -> lanes);
+    destructorReorderBuffer(manager -> reorder);
+    destructorTracer(manager -> tracer);
     free(manager);
     destructorBoundedBuffer(SharedBuffer);
 
     // Free DispatcherBuffersArray
-    for (int i = 0; i < NUM_ARTICLES_TYPES; ++i) {
+    for (int i = 0; i < numArticleTypes; ++i) {
         destructorUnboundedBuffer(DispatcherBuffersArray[i]);
     }
     free(DispatcherBuffersArray);
 
+    // Free the producers and their buffers
+    for (int i = 0; i < dispatcher -> TotalNumProducers; ++i) {
+        destructorBoundedBuffer(dispatcher -> producers[i] -> ProducerBuffer);
+        if (dispatcher -> producers[i] -> lanes != NULL) {
+            for (int j = 0; j < numArticleTypes; ++j) {
+                destructorBoundedBuffer(dispatcher -> producers[i] -> lanes[j]);
+            }
+        }
+        destructorArticlePool(dispatcher -> producers[i] -> pool);
+    }
+    // The producers, their counters and their rings are in the same block as the array (see createProducers)
+    free(dispatcher -> producers);
+
     // Free dispatcher
+    for (int i = 0; i < dispatcher -> numShards; ++i) {
+        free(dispatcher -> shards[i].byType);
+        free(dispatcher -> shards[i].typeCounts);
+        free(dispatcher -> shards[i].batchTypes);
+        free(dispatcher -> shards[i].readyMembers);
+        destroyReadySet(&dispatcher -> shards[i].ready);
+    }
+    if (dispatcher -> arena == NULL) {
+        free(dispatcher -> shards);
+    }
+    free(dispatcher -> typeRanks);
     free(dispatcher);
 
     // Free the config
@@ -0,0 +1,72 @@
+# include "Histogram.h"
+
+/*
+ * HDR style histogram: a bucket per value below HISTOGRAM_SUB_BUCKETS, then every power of two [2^k, 2^(k+1))
+ * is split into HISTOGRAM_SUB_BUCKETS equal buckets. The relative error is at most 1/HISTOGRAM_SUB_BUCKETS
+ * for any value up to 2^63 ns, and the size is fixed (no matter how many values are recorded).
+ */
+
+// Constructor of an empty Histogram.
+Histogram* constructorHistogram() {
+    Histogram* histogram = malloc(sizeof(Histogram));
+    if (histogram == NULL) {
+        perror("Failed to allocate memory for Histogram");
+        return NULL;
+    }
+    clearHistogram(histogram);
+    return histogram;
+}
+
+void clearHistogram(Histogram* histogram) {
+    memset(histogram, 0, sizeof(Histogram));
+}
+
+// Add all the values of 'from' to 'into'.
+void mergeHistogram(Histogram* into, const Histogram* from) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        into -> counts[i] += from -> counts[i];
+    }
+    into -> total += from -> total;
+    if (from -> max > into -> max) {
+        into -> max = from -> max;
+    }
+}
+
+// The smallest value of a bucket, and how many values it covers.
+void histogramBucketRange(int bucket, long long* lowest, long long* width) {
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    if (shift < 0) {
+        *lowest = bucket;
+        *width = 1;
+        return;
+    }
+    *lowest = (long long)(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << shift;
+    *width = 1LL << shift;
+}
+
+// The value below which 'fraction' (0..1) of the recorded values are (the middle of its bucket). 0 if empty.
+long long histogramPercentile(const Histogram* histogram, double fraction) {
+    if (histogram -> total == 0) {
+        return 0;
+    }
+    long long rank = (long long)(fraction * histogram -> total);
+    if (rank >= histogram -> total) {
+        rank = histogram -> total - 1;
+    }
+    long long seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += histogram -> counts[i];
+        if (seen > rank) {
+            long long lowest, width;
+            histogramBucketRange(i, &lowest, &width);
+            long long value = lowest + width / 2;
+            return value < histogram -> max ? value : histogram -> max;
+        }
+    }
+    return histogram -> max;
+}
+
+// Destructor for Histogram
+void destructorHistogram(Histogram* histogram) {
+    free(histogram);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#ifndef TASK3_HISTOGRAM_H
+#define TASK3_HISTOGRAM_H
+#include "Structs.h"
+
+// The bucket a value falls in: exact below HISTOGRAM_SUB_BUCKETS, then HISTOGRAM_SUB_BUCKETS buckets per power of two.
+static inline int histogramBucket(long long value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return value < 0 ? 0 : (int)value;
+    }
+    int shift = 63 - __builtin_clzll((unsigned long long)value) - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (int)((value >> shift) - HISTOGRAM_SUB_BUCKETS);
+}
+
+// Add a value. A handful of instructions and no allocation, so it can be called for every article.
+static inline void recordHistogram(Histogram* histogram, long long value) {
+    histogram -> counts[histogramBucket(value)] += 1;
+    histogram -> total += 1;
+    if (value > histogram -> max) {
+        histogram -> max = value;
+    }
+}
+
+Histogram* constructorHistogram();
+void clearHistogram(Histogram* histogram);
+void mergeHistogram(Histogram* into, const Histogram* from);
+long long histogramPercentile(const Histogram* histogram, double fraction);
+void destructorHistogram(Histogram* histogram);
+
+#endif //TASK3_HISTOGRAM_H
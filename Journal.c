@@ -0,0 +1,254 @@
+# include "Journal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * The journal is a durable, binary copy of the manager's output ("Journal <path>" in the config).
+ * The file is allocated JOURNAL_EXTENT_BYTES at a time and mapped whole, so writing a record is a plain copy
+ * into memory: no syscall and no formatting. The kernel writes the pages back by itself, and the manager calls
+ * msync on what it wrote since the last one every 'syncMs' (and when it is idle), so at most that much is lost
+ * in a crash. At the end the file is cut to the bytes used.
+ *
+ * Layout: a JournalHeader, the NUL terminated type names (padded to 8 bytes), then the JournalRecords.
+ * Every record starts with its length, which is written after the rest of it, and the file is zero filled
+ * past the last record, so a reader that maps the file while it is written stops at the first length 0.
+ */
+
+// Size of the header with the type names, rounded up to 8 so the records are aligned.
+size_t journalHeaderSize() {
+    size_t size = sizeof(JournalHeader);
+    for (int i = 0; i < numArticleTypes; ++i) {
+        size += strlen(types[i]) + 1;
+    }
+    return (size + 7) & ~(size_t)7;
+}
+
+// Make the file (and the mapping) at least 'needed' bytes. Returns -1 if it can't.
+int growJournal(Journal* journal, size_t needed) {
+    size_t capacity = journal -> capacity;
+    while (capacity < needed) {
+        capacity += JOURNAL_EXTENT_BYTES;
+    }
+    // Allocate the blocks now, so the page faults while writing don't have to (and we fail here, not with SIGBUS).
+    int error = posix_fallocate(journal -> fd, (off_t)journal -> capacity, (off_t)(capacity - journal -> capacity));
+    if (error != 0 && ftruncate(journal -> fd, (off_t)capacity) != 0) {
+        perror("Failed to grow the journal");
+        return -1;
+    }
+    char* base;
+    if (journal -> base == NULL) {
+        base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, journal -> fd, 0);
+    } else {
+        base = mremap(journal -> base, journal -> capacity, capacity, MREMAP_MAYMOVE);
+    }
+    if (base == MAP_FAILED) {
+        perror("Failed to map the journal");
+        return -1;
+    }
+    journal -> base = base;
+    journal -> capacity = capacity;
+    return 0;
+}
+
+// Constructor of a Journal that (re)creates the file 'path'. Returns NULL if the file can't be created.
+Journal* constructorJournal(const char* path, int syncMs) {
+    Journal* journal = malloc(sizeof(Journal));
+    if (journal == NULL) {
+        perror("Failed to allocate memory for Journal");
+        return NULL;
+    }
+    journal -> fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (journal -> fd == -1) {
+        perror("Failed to open the journal");
+        free(journal);
+        return NULL;
+    }
+    journal -> base = NULL;
+    journal -> capacity = 0;
+    journal -> syncIntervalNs = syncMs * 1000000LL;
+    journal -> failed = 0;
+    size_t headerSize = journalHeaderSize();
+    if (growJournal(journal, headerSize) != 0) {
+        close(journal -> fd);
+        free(journal);
+        return NULL;
+    }
+    JournalHeader* header = (JournalHeader*)journal -> base;
+    memcpy(header -> magic, JOURNAL_MAGIC, sizeof(header -> magic));
+    header -> version = JOURNAL_VERSION;
+    header -> headerSize = (uint32_t)headerSize;
+    header -> numTypes = numArticleTypes;
+    header -> reserved = 0;
+    char* name = journal -> base + sizeof(JournalHeader);
+    for (int i = 0; i < numArticleTypes; ++i) {
+        size_t length = strlen(types[i]) + 1;
+        memcpy(name, types[i], length);
+        name += length;
+    }
+    journal -> used = headerSize;
+    journal -> synced = 0;
+    journal -> firstUnsyncedNs = getMonotonicNs();
+    return journal;
+}
+
+// Append 'article', written by the manager at 'now'.
+void appendJournalArticle(Journal* journal, const Article* article, long long now) {
+    if (journal -> failed) {
+        return;
+    }
+    if (journal -> used + sizeof(JournalRecord) > journal -> capacity &&
+        growJournal(journal, journal -> used + sizeof(JournalRecord)) != 0) {
+        fprintf(stderr, "The journal is incomplete, it stops after %zu bytes\n", journal -> used);
+        journal -> failed = 1;
+        return;
+    }
+    if (journal -> synced == journal -> used) {
+        journal -> firstUnsyncedNs = now;
+    }
+    JournalRecord* record = (JournalRecord*)(journal -> base + journal -> used);
+    record -> producerId = article -> producerId;
+    record -> sequence = article -> sequence;
+    record -> type = (uint16_t)article -> type;
+    record -> flags = 0;
+    record -> createdNs = article -> stamps[STAMP_CREATED];
+    record -> writtenNs = now;
+    // Last, so a reader never sees the length of a record that is not all there.
+    atomic_store_explicit(&record -> length, sizeof(JournalRecord), memory_order_release);
+    journal -> used += sizeof(JournalRecord);
+}
+
+// Returns 1 if some records are not msync'ed yet.
+int hasUnsyncedJournal(Journal* journal) {
+    return journal -> synced < journal -> used;
+}
+
+// The time (monotonic clock, nanoseconds) at which the records that are not msync'ed yet have to be.
+long long journalSyncDeadline(Journal* journal) {
+    return journal -> firstUnsyncedNs + journal -> syncIntervalNs;
+}
+
+// msync everything written since the last time (from the page it starts in, msync wants aligned addresses).
+void syncJournal(Journal* journal) {
+    if (!hasUnsyncedJournal(journal)) {
+        return;
+    }
+    size_t start = journal -> synced & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+    if (msync(journal -> base + start, journal -> used - start, MS_SYNC) != 0) {
+        perror("Failed to sync the journal");
+    }
+    journal -> synced = journal -> used;
+}
+
+// Destructor for Journal: syncs it and cuts the file to the bytes used.
+void destructorJournal(Journal* journal) {
+    if (journal == NULL) {
+        return;
+    }
+    syncJournal(journal);
+    munmap(journal -> base, journal -> capacity);
+    if (ftruncate(journal -> fd, (off_t)journal -> used) != 0 || fsync(journal -> fd) != 0) {
+        perror("Failed to close the journal");
+    }
+    close(journal -> fd);
+    free(journal);
+}
+
+// Map the journal 'path' to read it. Returns NULL (and says why) if it is not a journal.
+JournalView* constructorJournalView(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("Failed to open the journal");
+        return NULL;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        perror("Failed to read the journal");
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)status.st_size;
+    if (size < sizeof(JournalHeader)) {
+        fprintf(stderr, "%s is not a journal\n", path);
+        close(fd);
+        return NULL;
+    }
+    char* base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file
+    if (base == MAP_FAILED) {
+        perror("Failed to map the journal");
+        return NULL;
+    }
+    JournalHeader* header = (JournalHeader*)base;
+    if (memcmp(header -> magic, JOURNAL_MAGIC, sizeof(header -> magic)) != 0 || header -> version != JOURNAL_VERSION ||
+        header -> headerSize > size || header -> headerSize % 8 != 0) {
+        fprintf(stderr, "%s is not a journal (or of another version)\n", path);
+        munmap(base, size);
+        return NULL;
+    }
+    JournalView* view = malloc(sizeof(JournalView));
+    const char** typeNames = malloc((header -> numTypes > 0 ? header -> numTypes : 1) * sizeof(char*));
+    if (view == NULL || typeNames == NULL) {
+        perror("Failed to allocate memory for JournalView");
+        free(view);
+        free(typeNames);
+        munmap(base, size);
+        return NULL;
+    }
+    // The names must all end inside the header.
+    const char* name = base + sizeof(JournalHeader);
+    const char* end = base + header -> headerSize;
+    for (uint32_t i = 0; i < header -> numTypes; ++i) {
+        const char* nul = name < end ? memchr(name, '\0', end - name) : NULL;
+        if (nul == NULL) {
+            fprintf(stderr, "%s has a broken header\n", path);
+            free(typeNames);
+            free(view);
+            munmap(base, size);
+            return NULL;
+        }
+        typeNames[i] = name;
+        name = nul + 1;
+    }
+    view -> base = base;
+    view -> size = size;
+    view -> typeNames = typeNames;
+    view -> numTypes = (int)header -> numTypes;
+    return view;
+}
+
+// The offset of the first record.
+size_t firstJournalRecord(JournalView* view) {
+    return ((JournalHeader*)view -> base) -> headerSize;
+}
+
+// The record at '*offset', which then moves to the next one. NULL at the end (or at a broken record).
+const JournalRecord* nextJournalRecord(JournalView* view, size_t* offset) {
+    if (*offset + sizeof(JournalRecord) > view -> size) {
+        return NULL;
+    }
+    JournalRecord* record = (JournalRecord*)(view -> base + *offset);
+    // A newer version may make the records longer, never shorter.
+    uint32_t length = atomic_load_explicit(&record -> length, memory_order_acquire);
+    if (length < sizeof(JournalRecord) || length > view -> size - *offset) {
+        return NULL;
+    }
+    *offset += (length + 7) & ~(uint32_t)7;
+    return record;
+}
+
+// The name of type 'type' of the journal ("?" if it has no such type).
+const char* journalTypeName(JournalView* view, int type) {
+    return type >= 0 && type < view -> numTypes ? view -> typeNames[type] : "?";
+}
+
+// Destructor for JournalView.
+void destructorJournalView(JournalView* view) {
+    if (view == NULL) {
+        return;
+    }
+    munmap(view -> base, view -> size);
+    free(view -> typeNames);
+    free(view);
+}
@@ -0,0 +1,18 @@
+#pragma once
+#ifndef TASK3_JOURNAL_H
+#define TASK3_JOURNAL_H
+#include "Structs.h"
+size_t journalHeaderSize();
+int growJournal(Journal* journal, size_t needed);
+Journal* constructorJournal(const char* path, int syncMs);
+void appendJournalArticle(Journal* journal, const Article* article, long long now);
+int hasUnsyncedJournal(Journal* journal);
+long long journalSyncDeadline(Journal* journal);
+void syncJournal(Journal* journal);
+void destructorJournal(Journal* journal);
+JournalView* constructorJournalView(const char* path);
+size_t firstJournalRecord(JournalView* view);
+const JournalRecord* nextJournalRecord(JournalView* view, size_t* offset);
+const char* journalTypeName(JournalView* view, int type);
+void destructorJournalView(JournalView* view);
+#endif //TASK3_JOURNAL_H
@@ -0,0 +1,62 @@
+#include "Structs.h"
+
+/*
+ * Reads a journal written by the manager ("Journal <path>" in the config, see Journal.c). Built as journal.out.
+ * Usage: journal.out <journal> [summary]
+ * Prints every article as the manager printed it ("Producer <id> <type> <sequence>"), or with 'summary' only the
+ * number of articles of every type and how long they took from their producer to the journal.
+ * The file is mapped, not read, so it can be scanned while the pipeline is still appending to it.
+ */
+
+// Print every record of the journal like the manager's output.
+long long printJournal(JournalView* view) {
+    long long count = 0;
+    size_t offset = firstJournalRecord(view);
+    const JournalRecord* record;
+    while ((record = nextJournalRecord(view, &offset)) != NULL) {
+        printf("Producer %d %s %d\n", record -> producerId, journalTypeName(view, record -> type), record -> sequence);
+        count++;
+    }
+    return count;
+}
+
+// Print the number of records of each type and their latency percentiles.
+long long summarizeJournal(JournalView* view) {
+    long long counts[view -> numTypes + 1]; // The last one counts the records of an unknown type
+    memset(counts, 0, sizeof(counts));
+    Histogram* latencies = constructorHistogram();
+    long long count = 0;
+    size_t offset = firstJournalRecord(view);
+    const JournalRecord* record;
+    while ((record = nextJournalRecord(view, &offset)) != NULL) {
+        counts[record -> type < view -> numTypes ? record -> type : view -> numTypes]++;
+        recordHistogram(latencies, record -> writtenNs - record -> createdNs);
+        count++;
+    }
+    for (int i = 0; i < view -> numTypes; ++i) {
+        printf("%-10s %12lld articles\n", view -> typeNames[i], counts[i]);
+    }
+    if (counts[view -> numTypes] > 0) {
+        printf("%-10s %12lld articles\n", "?", counts[view -> numTypes]);
+    }
+    printf("latency p50 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms\n",
+           histogramPercentile(latencies, 0.5) / 1e6, histogramPercentile(latencies, 0.99) / 1e6,
+           histogramPercentile(latencies, 0.999) / 1e6, latencies -> max / 1e6);
+    destructorHistogram(latencies);
+    return count;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3 || (argc == 3 && strcmp(argv[2], "summary") != 0)) {
+        fprintf(stderr, "Usage: %s <journal> [summary]\n", argv[0]);
+        return 1;
+    }
+    JournalView* view = constructorJournalView(argv[1]);
+    if (view == NULL) {
+        return 1;
+    }
+    long long count = argc == 3 ? summarizeJournal(view) : printJournal(view);
+    fprintf(stderr, "%lld articles\n", count);
+    destructorJournalView(view);
+    return 0;
+}
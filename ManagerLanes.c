@@ -0,0 +1,186 @@
+# include "ManagerLanes.h"
+
+/*
+ * With "Priority <type> <weight>" or "Deadline <type> <milliseconds>" in the config, the co-editors -> manager
+ * queue is split into a lane per type, so a burst of one type no longer waits in front of the others.
+ * The co-editors of a type write to its lane (it is their SharedBuffer) and every insert posts readySemaphore,
+ * so the manager sleeps on a single semaphore like it did on the single buffer.
+ * Every article the manager takes is chosen by the policy among the oldest article of every lane:
+ *  - LANES_DEADLINE (some type has a deadline): the one whose deadline (created + its type's deadline) is first.
+ *    A type without a deadline gets the longest one given, so it still goes out, after the urgent ones.
+ *  - LANES_WEIGHTED (only weights): deficit round robin, up to 'weight' articles of a type before moving on.
+ * The articles of a type still leave in the order the co-editors inserted them.
+ */
+
+// Returns 1 if the config asks for lanes (some type has a weight or a deadline).
+int managerLanesWanted(Config* config) {
+    for (int i = 0; i < numArticleTypes; ++i) {
+        if (config -> TypeWeights[i] != 1 || config -> TypeDeadlineMs[i] > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Returns 1 if type 'a' goes before type 'b': a deadline before none, then the shorter deadline, then the higher weight.
+int typeIsMoreUrgent(Config* config, int a, int b) {
+    int deadlineA = config -> TypeDeadlineMs[a], deadlineB = config -> TypeDeadlineMs[b];
+    if (deadlineA != deadlineB) {
+        return deadlineA > 0 && (deadlineB == 0 || deadlineA < deadlineB);
+    }
+    return config -> TypeWeights[a] > config -> TypeWeights[b];
+}
+
+// Write the types to 'order', most urgent first (the same urgency keeps the order of 'types').
+void typePriorityOrder(Config* config, int* order) {
+    for (int i = 0; i < numArticleTypes; ++i) {
+        int j = i;
+        while (j > 0 && typeIsMoreUrgent(config, i, order[j - 1])) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+}
+
+// Constructor of the ManagerLanes: a lane of 'QueueLengthCoEditor' articles per type.
+ManagerLanes* constructorManagerLanes(Config* config) {
+    ManagerLanes* lanes = malloc(sizeof(ManagerLanes));
+    if (lanes == NULL) {
+        perror("Failed to allocate memory for ManagerLanes");
+        return NULL;
+    }
+    lanes -> lanes = malloc(numArticleTypes * sizeof(ManagerLane));
+    if (lanes -> lanes == NULL) {
+        perror("Failed to allocate memory for ManagerLanes");
+        free(lanes);
+        return NULL;
+    }
+    initSemaphore(&lanes -> readySemaphore, 0, 0);
+    lanes -> waitStrategy = config -> WaitStrategies[QUEUE_SHARED];
+    lanes -> policy = LANES_WEIGHTED;
+    lanes -> longestDeadlineNs = 0;
+    for (int i = 0; i < numArticleTypes; ++i) {
+        ManagerLane* lane = &lanes -> lanes[i];
+        lane -> buffer = constructorMpscBoundedBuffer(config -> QueueLengthCoEditor);
+        if (lane -> buffer == NULL) {
+            exit(-1);
+        }
+        lane -> buffer -> readySemaphore = &lanes -> readySemaphore;
+        lane -> buffer -> waitStrategy = config -> WaitStrategies[QUEUE_SHARED];
+        STATS_QUEUE_REGISTER(lane -> buffer, "lane", i);
+        lane -> weight = config -> TypeWeights[i];
+        lane -> deadlineNs = config -> TypeDeadlineMs[i] * 1000000LL;
+        if (lane -> deadlineNs > lanes -> longestDeadlineNs) {
+            lanes -> longestDeadlineNs = lane -> deadlineNs;
+        }
+        lane -> written = 0;
+        lane -> missed = 0;
+        lane -> worstLateNs = 0;
+    }
+    if (lanes -> longestDeadlineNs > 0) {
+        lanes -> policy = LANES_DEADLINE;
+    }
+    lanes -> current = 0;
+    lanes -> credit = lanes -> lanes[0].weight;
+    return lanes;
+}
+
+// LANES_DEADLINE: the lane whose oldest article has the first deadline, -1 if no lane has one yet.
+int earliestDeadlineLane(ManagerLanes* lanes) {
+    int best = -1;
+    long long bestDeadline = 0;
+    for (int i = 0; i < numArticleTypes; ++i) {
+        Article* article = peekBoundedBuffer(lanes -> lanes[i].buffer);
+        if (article == NULL) {
+            continue;
+        }
+        long long deadline = article -> stamps[STAMP_CREATED] +
+                             (lanes -> lanes[i].deadlineNs > 0 ? lanes -> lanes[i].deadlineNs : lanes -> longestDeadlineNs);
+        if (best == -1 || deadline < bestDeadline) {
+            best = i;
+            bestDeadline = deadline;
+        }
+    }
+    return best;
+}
+
+// LANES_WEIGHTED: the lane to take the next article from, -1 if all of them are empty.
+// An empty lane loses what is left of its credit, like in deficit round robin.
+int weightedLane(ManagerLanes* lanes) {
+    for (int tried = 0; tried <= numArticleTypes; ++tried) {
+        if (lanes -> credit > 0 && peekBoundedBuffer(lanes -> lanes[lanes -> current].buffer) != NULL) {
+            lanes -> credit--;
+            return lanes -> current;
+        }
+        lanes -> current = (lanes -> current + 1) % numArticleTypes;
+        lanes -> credit = lanes -> lanes[lanes -> current].weight;
+    }
+    return -1;
+}
+
+/*
+ * Block until there is at least one article in the lanes (or until 'deadlineNs', if it is not 0),
+ * then take up to 'max' articles, choosing every one of them by the lanes' policy.
+ * Returns how many articles were written to 'articles' (0 if the deadline passed).
+ */
+int removeManagerLanesUntil(ManagerLanes* lanes, Article** articles, int max, long long deadlineNs) {
+    int count = waitSemaphoreBatch(&lanes -> readySemaphore, max, deadlineNs, lanes -> waitStrategy);
+    if (count == 0) {
+        return 0;
+    }
+    // Every post was made after its article was inserted, so the lanes hold at least 'count' articles.
+    for (int i = 0; i < count; ++i) {
+        int lane;
+        // The article of a post may sit behind one that its writer is just publishing, wait for it.
+        while ((lane = lanes -> policy == LANES_DEADLINE ? earliestDeadlineLane(lanes) : weightedLane(lanes)) == -1) {
+            sched_yield();
+        }
+        articles[i] = removeBoundedBuffer(lanes -> lanes[lane].buffer);
+    }
+    return count;
+}
+
+// Count an article the manager wrote at 'now' (and whether it missed its type's deadline).
+void recordManagerLaneOutput(ManagerLanes* lanes, const Article* article, long long now) {
+    ManagerLane* lane = &lanes -> lanes[article -> type];
+    lane -> written += 1;
+    if (lane -> deadlineNs == 0) {
+        return;
+    }
+    long long lateNs = now - article -> stamps[STAMP_CREATED] - lane -> deadlineNs;
+    if (lateNs > 0) {
+        lane -> missed += 1;
+        if (lateNs > lane -> worstLateNs) {
+            lane -> worstLateNs = lateNs;
+        }
+    }
+}
+
+// Print how many articles of every type were written and how many missed their deadline.
+void printManagerLanes(ManagerLanes* lanes, FILE* file) {
+    fprintf(file, "Manager lanes (%s):\n", lanes -> policy == LANES_DEADLINE ? "earliest deadline first" : "weighted");
+    for (int i = 0; i < numArticleTypes; ++i) {
+        ManagerLane* lane = &lanes -> lanes[i];
+        fprintf(file, "  %-8s weight %3d: %10lld articles", types[i], lane -> weight, lane -> written);
+        if (lane -> deadlineNs > 0) {
+            fprintf(file, ", deadline %lld ms missed %lld times (%.2f%%), worst %.3f ms late",
+                    lane -> deadlineNs / 1000000, lane -> missed,
+                    lane -> written > 0 ? 100.0 * lane -> missed / lane -> written : 0.0, lane -> worstLateNs / 1e6);
+        }
+        fprintf(file, "\n");
+    }
+    fflush(file);
+}
+
+// Destructor for ManagerLanes.
+void destructorManagerLanes(ManagerLanes* lanes) {
+    if (lanes == NULL) {
+        return;
+    }
+    for (int i = 0; i < numArticleTypes; ++i) {
+        destructorBoundedBuffer(lanes -> lanes[i].buffer);
+    }
+    free(lanes -> lanes);
+    free(lanes);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#ifndef TASK3_MANAGERLANES_H
+#define TASK3_MANAGERLANES_H
+#include "Structs.h"
+int managerLanesWanted(Config* config);
+int typeIsMoreUrgent(Config* config, int a, int b);
+void typePriorityOrder(Config* config, int* order);
+ManagerLanes* constructorManagerLanes(Config* config);
+int earliestDeadlineLane(ManagerLanes* lanes);
+int weightedLane(ManagerLanes* lanes);
+int removeManagerLanesUntil(ManagerLanes* lanes, Article** articles, int max, long long deadlineNs);
+void recordManagerLaneOutput(ManagerLanes* lanes, const Article* article, long long now);
+void printManagerLanes(ManagerLanes* lanes, FILE* file);
+void destructorManagerLanes(ManagerLanes* lanes);
+#endif //TASK3_MANAGERLANES_H
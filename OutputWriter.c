@@ -0,0 +1,146 @@
+# include "OutputWriter.h"
+#include <errno.h>
+#include <sys/uio.h>
+
+/*
+ * The manager used to printf every article, which costs a lock and (on a pipe or a file) often a syscall per line.
+ * Now the lines are collected in chunks and written together with a single writev when enough bytes are waiting,
+ * or when the oldest waiting line is older than the flush interval. The bytes are exactly the ones printf wrote.
+ */
+
+// Constructor of an Output Writer that writes to 'fd'.
+OutputWriter* constructorOutputWriter(int fd, int flushBytes, int flushMs) {
+    OutputWriter* writer = malloc(sizeof(OutputWriter));
+    if (writer == NULL) {
+        perror("Failed to allocate memory for OutputWriter");
+        return NULL;
+    }
+    writer -> fd = fd;
+    writer -> flushBytes = flushBytes > 0 ? flushBytes : 1;
+    writer -> flushIntervalNs = flushMs * 1000000LL;
+    // Enough chunks to hold 'flushBytes' plus one line that didn't fit in the last one.
+    writer -> numChunks = (int)((writer -> flushBytes + OUTPUT_MAX_LINE) / OUTPUT_CHUNK_SIZE) + 1;
+    writer -> chunks = malloc(writer -> numChunks * sizeof(char*));
+    writer -> chunkSizes = malloc(writer -> numChunks * sizeof(size_t));
+    if (writer -> chunks == NULL || writer -> chunkSizes == NULL) {
+        perror("Failed to allocate memory for OutputWriter");
+        free(writer -> chunks);
+        free(writer -> chunkSizes);
+        free(writer);
+        return NULL;
+    }
+    for (int i = 0; i < writer -> numChunks; ++i) {
+        writer -> chunks[i] = malloc(OUTPUT_CHUNK_SIZE);
+        if (writer -> chunks[i] == NULL) {
+            perror("Failed to allocate memory for OutputWriter");
+            exit(-1);
+        }
+    }
+    writer -> current = 0;
+    writer -> used = 0;
+    writer -> pending = 0;
+    writer -> firstPendingNs = 0;
+    return writer;
+}
+
+// Make room for 'length' bytes in the current chunk (moving to the next chunk, or flushing, if needed).
+char* reserveOutput(OutputWriter* writer, size_t length) {
+    if (writer -> used + length > OUTPUT_CHUNK_SIZE) {
+        if (writer -> current + 1 == writer -> numChunks) {
+            flushOutput(writer);
+        } else {
+            writer -> chunkSizes[writer -> current] = writer -> used;
+            writer -> current += 1;
+            writer -> used = 0;
+        }
+    }
+    if (writer -> pending == 0) {
+        writer -> firstPendingNs = getMonotonicNs();
+    }
+    return writer -> chunks[writer -> current] + writer -> used;
+}
+
+// Account for 'length' bytes that were written at the place reserveOutput returned, and flush if it is time to.
+void commitOutput(OutputWriter* writer, size_t length) {
+    writer -> used += length;
+    writer -> pending += length;
+    if (writer -> pending >= writer -> flushBytes || getMonotonicNs() >= outputFlushDeadline(writer)) {
+        flushOutput(writer);
+    }
+}
+
+// Add text to the output ('length' must not be more than OUTPUT_MAX_LINE).
+void writeOutput(OutputWriter* writer, const char* text, size_t length) {
+    char* place = reserveOutput(writer, length);
+    memcpy(place, text, length);
+    commitOutput(writer, length);
+}
+
+// Add the line of an article to the output.
+void writeArticleOutput(OutputWriter* writer, const Article* article) {
+    char* place = reserveOutput(writer, OUTPUT_MAX_LINE);
+    int length = snprintf(place, OUTPUT_MAX_LINE, "Producer %d %s %d\n",
+                          article -> producerId, types[article -> type], article -> sequence);
+    commitOutput(writer, length);
+}
+
+// Returns 1 if some output is waiting to be written.
+int hasPendingOutput(OutputWriter* writer) {
+    return writer -> pending > 0;
+}
+
+// The time (monotonic clock, nanoseconds) at which the waiting output has to be written.
+long long outputFlushDeadline(OutputWriter* writer) {
+    return writer -> firstPendingNs + writer -> flushIntervalNs;
+}
+
+// Write everything that is waiting with writev (more than once only if the kernel took part of it).
+void flushOutput(OutputWriter* writer) {
+    struct iovec iov[writer -> numChunks];
+    int count = 0;
+    for (int i = 0; i <= writer -> current; ++i) {
+        iov[count].iov_base = writer -> chunks[i];
+        iov[count].iov_len = i < writer -> current ? writer -> chunkSizes[i] : writer -> used;
+        if (iov[count].iov_len > 0) {
+            count++;
+        }
+    }
+    struct iovec* next = iov;
+    while (count > 0) {
+        ssize_t written = writev(writer -> fd, next, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Failed to write output");
+            break;
+        }
+        // Skip what was written
+        while (count > 0 && (size_t)written >= next -> iov_len) {
+            written -= next -> iov_len;
+            next++;
+            count--;
+        }
+        if (count > 0) {
+            next -> iov_base = (char*)next -> iov_base + written;
+            next -> iov_len -= written;
+        }
+    }
+    writer -> current = 0;
+    writer -> used = 0;
+    writer -> pending = 0;
+}
+
+// Destructor for OutputWriter (writes whatever is still waiting).
+void destructorOutputWriter(OutputWriter* writer) {
+    if (writer == NULL) {
+        return;
+    }
+    flushOutput(writer);
+    for (int i = 0; i < writer -> numChunks; ++i) {
+        free(writer -> chunks[i]);
+    }
+    free(writer -> chunks);
+    free(writer -> chunkSizes);
+    free(writer);
+}
@@ -0,0 +1,12 @@
+#pragma once
+#ifndef TASK3_OUTPUTWRITER_H
+#define TASK3_OUTPUTWRITER_H
+#include "Structs.h"
+OutputWriter* constructorOutputWriter(int fd, int flushBytes, int flushMs);
+void writeOutput(OutputWriter* writer, const char* text, size_t length);
+void writeArticleOutput(OutputWriter* writer, const Article* article);
+int hasPendingOutput(OutputWriter* writer);
+long long outputFlushDeadline(OutputWriter* writer);
+void flushOutput(OutputWriter* writer);
+void destructorOutputWriter(OutputWriter* writer);
+#endif //TASK3_OUTPUTWRITER_H
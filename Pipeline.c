@@ -0,0 +1,129 @@
+#include "Pipeline.h"
+char* defaultTypes[DEFAULT_NUM_ARTICLE_TYPES] = {"Sports", "News", "Weather"};
+char** types = defaultTypes;
+int numArticleTypes = DEFAULT_NUM_ARTICLE_TYPES;
+Article DoneArticle = {.producerId = -1, .type = -1, .sequence = -1, .flags = ARTICLE_DONE};
+
+// The producers are either run by 'producerWorkers' or are 'producerProcesses' (the other one is NULL).
+void joinThreads(ProducerScheduler* producerWorkers, ProducerProcesses* producerProcesses,
+                 pthread_t* dispatcherThreads, int numDispatcherThreads,
+                 pthread_t* coEditorThreads, int numCoEditorThreads, pthread_t ManagerThreadID) {
+    if (producerWorkers != NULL) {
+        joinProducerScheduler(producerWorkers);
+    } else {
+        joinProducerProcesses(producerProcesses);
+    }
+    for (int i = 0; i < numDispatcherThreads; ++i) {
+        pthread_join(dispatcherThreads[i], NULL);
+    }
+    for (int i = 0; i < numCoEditorThreads; ++i) {
+        pthread_join(coEditorThreads[i], NULL);
+    }
+    pthread_join(ManagerThreadID, NULL);
+}
+
+// Run the whole pipeline (producers -> dispatcher -> co-editors -> manager) until the manager prints "DONE".
+// If 'latencies' is not NULL the manager records in it how long every article took from its producer to the output.
+// The config is freed at the end.
+void runPipeline(Config* config, Histogram* latencies) {
+    // The article types of this config (the producer processes inherit them when they are forked)
+    types = config -> Types;
+    numArticleTypes = config -> NumTypes;
+    // SIGUSR1 prints the counters (only with -DINSTRUMENT): block it before any other thread or process exists.
+    STATS_BLOCK_SIGNAL();
+    // With "ProducerProcesses on" the producers' buffers and articles are in shared memory
+    SharedArena* arena = NULL;
+    if (config -> ProducerProcesses) {
+        arena = constructorSharedArena(producerProcessesArenaSize(config));
+        if (arena == NULL) {
+            exit(-1);
+        }
+    }
+    // Create array of Producer pointers, one for each producer specified in the config file
+    Producer** ArrayProducers = createProducers(config, arena);
+    // Create an array of BoundedBuffer pointers, one for each type of message
+    UnboundedBuffer** DispatcherBuffersArray = createDispatcherBuffers(config);
+    // Create a dispatcher and assign the producers to it
+    Dispatcher* dispatcher = createDispatcher(ArrayProducers, config, DispatcherBuffersArray, arena);
+    // Decide on which CPUs every thread runs ("Affinity" in the config)
+    Placement* placement = constructorPlacement(config, dispatcher -> numShards);
+    // Start the producer processes (forked before any other thread exists)
+    ProducerScheduler* producerWorkers = NULL;
+    ProducerProcesses* producerProcesses = NULL;
+    if (arena != NULL) {
+        producerProcesses = startProducerProcesses(ArrayProducers, config -> TotalNumProducers, arena, placement);
+        if (producerProcesses == NULL) {
+            exit(-1);
+        }
+    }
+    // The thread that prints the counters on SIGUSR1. Only now: a child forked while it holds the stats or
+    // stdio locks would deadlock on them.
+    STATS_START();
+    // Create the dispatcher threads (one per shard of the producers, none with direct routing)
+    pthread_t* dispatcherThreads = NULL;
+    int numDispatcherThreads = 0;
+    if (!config -> DirectRouting) {
+        dispatcherThreads = createDispatcherThreads(dispatcher, placement);
+        numDispatcherThreads = dispatcher -> numShards;
+    }
+    // Create a shared bounded buffer for the co-editors and the manager
+    // All the co-editors write to it and only the manager reads from it, so it doesn't need a lock.
+    // With "Priority" or "Deadline" in the config it is a lane per type instead.
+    BoundedBuffer* SharedBuffer = NULL;
+    ManagerLanes* managerLanes = NULL;
+    if (managerLanesWanted(config)) {
+        managerLanes = constructorManagerLanes(config);
+        if (managerLanes == NULL) {
+            exit(-1);
+        }
+    } else {
+        SharedBuffer = constructorMpscBoundedBuffer(config -> QueueLengthCoEditor);
+        SharedBuffer -> waitStrategy = config -> WaitStrategies[QUEUE_SHARED];
+        STATS_QUEUE_REGISTER(SharedBuffer, "shared", 0);
+    }
+    // Create co-editor threads
+    CoEditor** ArrayCoEditors;
+    int numCoEditorThreads;
+    pthread_t* coEditorThreads = createCoEditorThreads(dispatcher, SharedBuffer, managerLanes, config, &ArrayCoEditors,
+                                                       &numCoEditorThreads, placement);
+    // Start the threads that run the producers (after the co-editors: with direct routing they wire the lanes)
+    if (arena == NULL) {
+        producerWorkers = createProducerWorkers(ArrayProducers, config, placement);
+    }
+    // Allocate memory for Struct manager and declare it.
+    Manager* manager = createManager(SharedBuffer, managerLanes, config);
+    manager -> latencies = latencies;
+    // Create manager thread
+    pthread_t ManagerThreadID = createManagerThread(manager, placement);
+    // Join threads
+    joinThreads(producerWorkers, producerProcesses, dispatcherThreads, numDispatcherThreads, coEditorThreads, numCoEditorThreads,
+                ManagerThreadID);
+    free(dispatcherThreads);
+    destructorProducerScheduler(producerWorkers);
+    destructorProducerProcesses(producerProcesses);
+    destructorPlacement(placement);
+    // Print how the articles memory was used (to check there are no mallocs while running)
+    if (getenv("ARTICLE_POOL_STATS") != NULL) {
+        printArticlePoolStats(ArrayProducers, config -> TotalNumProducers, stderr);
+    }
+    // Print the per hop latencies ("Tracing on" in the config)
+    if (manager -> tracer != NULL) {
+        printTracer(manager -> tracer, stderr);
+    }
+    // Print how every type did against its deadline ("Priority" or "Deadline" in the config)
+    if (manager -> lanes != NULL) {
+        printManagerLanes(manager -> lanes, stderr);
+    }
+    // Print how many articles came out of order ("Reorder" in the config)
+    if (manager -> reorder != NULL) {
+        printReorderBuffer(manager -> reorder, stderr);
+    }
+    // Print the counters (only with -DINSTRUMENT) while the queues still exist
+    STATS_FINISH(stderr);
+    // Clean up
+    FreeResources(config, ArrayCoEditors, coEditorThreads, manager, SharedBuffer, DispatcherBuffersArray, dispatcher);
+    destructorSharedArena(arena);
+    // The config's types were freed with it
+    types = defaultTypes;
+    numArticleTypes = DEFAULT_NUM_ARTICLE_TYPES;
+}
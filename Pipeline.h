@@ -0,0 +1,9 @@
+#pragma once
+#ifndef TASK3_PIPELINE_H
+#define TASK3_PIPELINE_H
+#include "Structs.h"
+void joinThreads(ProducerScheduler* producerWorkers, ProducerProcesses* producerProcesses,
+                 pthread_t* dispatcherThreads, int numDispatcherThreads,
+                 pthread_t* coEditorThreads, int numCoEditorThreads, pthread_t ManagerThreadID);
+void runPipeline(Config* config, Histogram* latencies);
+#endif //TASK3_PIPELINE_H
@@ -1,68 +1,652 @@
 # include "ProcessConfig.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-Producer* reallocateProducers(Producer* OldArray, int capacity) {
-    Producer* NewArray = realloc(OldArray, capacity * sizeof(Producer));
-    if (NewArray == NULL) {
-        perror("Failed to reallocate memory for ArrayProducers");
-        exit(-1);
+/*
+ * The config file is mapped and read in one pass, without stdio: the producers ("<id> <articles> <queue size>",
+ * with ids 1, 2, 3...), the co-editor queue size and then the optional settings, one per line.
+ * The producer array is allocated once, big enough for the most producers a file of this size can hold, so it is
+ * never copied while it fills. Every number is checked, and a bad one is reported with its line.
+ */
+
+// Skip the spaces and newlines at the scanner.
+void skipConfigSpaces(ConfigScanner* scanner) {
+    while (scanner -> next < scanner -> end && isspace((unsigned char)*scanner -> next)) {
+        if (*scanner -> next == '\n') {
+            scanner -> line++;
+        }
+        scanner -> next++;
+    }
+}
+
+// Read the non negative number at the scanner into '*value'.
+// Returns 1 if there is one, 0 if there is something else (or nothing) and -1 if it is broken or too big.
+int scanConfigNumber(ConfigScanner* scanner, int* value) {
+    skipConfigSpaces(scanner);
+    if (scanner -> next == scanner -> end || !isdigit((unsigned char)*scanner -> next)) {
+        return 0;
+    }
+    long long number = 0;
+    while (scanner -> next < scanner -> end && isdigit((unsigned char)*scanner -> next)) {
+        number = number * 10 + (*scanner -> next - '0');
+        if (number > INT_MAX) {
+            return -1;
+        }
+        scanner -> next++;
+    }
+    if (scanner -> next < scanner -> end && !isspace((unsigned char)*scanner -> next)) {
+        return -1; // Like "12abc"
+    }
+    *value = (int)number;
+    return 1;
+}
+
+// Copy the line at the scanner (without its newline) into 'line' and move to the next one.
+// Returns 1 if there was a line, 0 at the end of the file and -1 if it does not fit.
+int nextConfigLine(ConfigScanner* scanner, char* line, size_t size) {
+    if (scanner -> next == scanner -> end) {
+        return 0;
+    }
+    const char* newline = memchr(scanner -> next, '\n', scanner -> end - scanner -> next);
+    const char* lineEnd = newline != NULL ? newline : scanner -> end;
+    size_t length = lineEnd - scanner -> next;
+    int result = length < size ? 1 : -1;
+    if (result == 1) {
+        memcpy(line, scanner -> next, length);
+        line[length] = '\0';
+    }
+    scanner -> next = newline != NULL ? newline + 1 : scanner -> end;
+    scanner -> line++;
+    return result;
+}
+
+// Returns the index of the type with this name in the config's types, or -1.
+int findArticleType(const Config* config, const char* name) {
+    for (int i = 0; i < config -> NumTypes; ++i) {
+        if (strcmp(config -> Types[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// "CoEditors <count>" sets the number of co-editor threads of every type,
+// "CoEditors <type> <count>" sets it only for that type.
+int processCoEditorsOption(const char* line, Config* config) {
+    char typeName[64];
+    int count;
+    if (sscanf(line, "CoEditors %63s %d", typeName, &count) == 2) {
+        int type = findArticleType(config, typeName);
+        if (type == -1 || count < 1) {
+            return -1;
+        }
+        config -> CoEditorWorkers[type] = count;
+        return 0;
+    }
+    if (sscanf(line, "CoEditors %d", &count) == 1 && count >= 1) {
+        for (int i = 0; i < config -> NumTypes; ++i) {
+            config -> CoEditorWorkers[i] = count;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+// "OutputFlush <bytes> <milliseconds>": the manager writes its output once this many bytes are waiting
+// or once the oldest waiting line is this old.
+int processOutputFlushOption(const char* line, Config* config) {
+    int bytes, milliseconds;
+    if (sscanf(line, "OutputFlush %d %d", &bytes, &milliseconds) != 2 || bytes < 1 || milliseconds < 0) {
+        return -1;
+    }
+    config -> OutputFlushBytes = bytes;
+    config -> OutputFlushMs = milliseconds;
+    return 0;
+}
+
+// "EditDelay <microseconds>": how long a co-editor takes to edit an article (0 = no delay).
+int processEditDelayOption(const char* line, Config* config) {
+    int microseconds;
+    if (sscanf(line, "EditDelay %d", &microseconds) != 1 || microseconds < 0) {
+        return -1;
+    }
+    config -> EditDelayUsec = microseconds;
+    return 0;
+}
+
+// "Tracing on|off": record how long every article spends in every stage, printed when the pipeline ends.
+int processTracingOption(const char* line, Config* config) {
+    char value[16];
+    if (sscanf(line, "Tracing %15s", value) != 1) {
+        return -1;
+    }
+    if (strcmp(value, "on") == 0) {
+        config -> Tracing = 1;
+    } else if (strcmp(value, "off") == 0) {
+        config -> Tracing = 0;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// "WaitStrategy <queue|all> blocking|adaptive": how the threads wait when a queue is empty or full.
+// The queues are "producer" (producers -> dispatcher), "dispatcher" (dispatcher -> co-editors)
+// and "shared" (co-editors -> manager).
+int processWaitStrategyOption(const char* line, Config* config) {
+    const char* queues[NUM_QUEUE_STAGES] = {"producer", "dispatcher", "shared"};
+    char queue[16], mode[16];
+    if (sscanf(line, "WaitStrategy %15s %15s", queue, mode) != 2) {
+        return -1;
+    }
+    WaitStrategy strategy;
+    if (strcmp(mode, "blocking") == 0) {
+        strategy = WAIT_BLOCKING;
+    } else if (strcmp(mode, "adaptive") == 0) {
+        strategy = WAIT_ADAPTIVE;
+    } else {
+        return -1;
+    }
+    int found = 0;
+    for (int i = 0; i < NUM_QUEUE_STAGES; ++i) {
+        if (strcmp(queue, "all") == 0 || strcmp(queue, queues[i]) == 0) {
+            config -> WaitStrategies[i] = strategy;
+            found = 1;
+        }
+    }
+    return found ? 0 : -1;
+}
+
+// "ProducerWorkers <n>": number of threads that run the producers (0 = one per CPU).
+int processProducerWorkersOption(const char* line, Config* config) {
+    int workers;
+    if (sscanf(line, "ProducerWorkers %d", &workers) != 1 || workers < 0) {
+        return -1;
+    }
+    config -> ProducerWorkers = workers;
+    return 0;
+}
+
+// "Dispatchers <k>": number of dispatcher threads, each reads a slice of the producers.
+int processDispatchersOption(const char* line, Config* config) {
+    int dispatchers;
+    if (sscanf(line, "Dispatchers %d", &dispatchers) != 1 || dispatchers < 1) {
+        return -1;
+    }
+    config -> Dispatchers = dispatchers;
+    return 0;
+}
+
+// "AsyncEdits <n>": every co-editor thread keeps up to n edits in flight (0 = one edit at a time).
+int processAsyncEditsOption(const char* line, Config* config) {
+    int edits;
+    if (sscanf(line, "AsyncEdits %d", &edits) != 1 || edits < 0) {
+        return -1;
+    }
+    config -> AsyncEdits = edits;
+    return 0;
+}
+
+// "Affinity auto": place the stages on the CPU packages by themselves.
+// "Affinity <stage> <cpus>": run a stage only on some CPUs, e.g "Affinity manager 3" or "Affinity producers 0-1,4".
+// The stages are "producers", "dispatchers", "coeditors" and "manager".
+int processAffinityOption(const char* line, Config* config) {
+    const char* stages[NUM_THREAD_STAGES] = {"producers", "dispatchers", "coeditors", "manager"};
+    char stage[16], cpus[200];
+    int fields = sscanf(line, "Affinity %15s %199s", stage, cpus);
+    if (fields == 1 && strcmp(stage, "auto") == 0) {
+        config -> AutoAffinity = 1;
+        return 0;
+    }
+    if (fields != 2) {
+        return -1;
+    }
+    for (int i = 0; i < NUM_THREAD_STAGES; ++i) {
+        if (strcmp(stage, stages[i]) == 0) {
+            if (parseCpuList(cpus, &config -> StageCpus[i]) != 0) {
+                return -1;
+            }
+            config -> StagePinned[i] = 1;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// "ProducerProcesses on|off": run every producer as a child process that feeds shared memory.
+int processProducerProcessesOption(const char* line, Config* config) {
+    char value[16];
+    if (sscanf(line, "ProducerProcesses %15s", value) != 1) {
+        return -1;
+    }
+    if (strcmp(value, "on") == 0) {
+        config -> ProducerProcesses = 1;
+    } else if (strcmp(value, "off") == 0) {
+        config -> ProducerProcesses = 0;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// "DirectRouting on|off": the producers write to per-type lanes the co-editors read, without a dispatcher.
+int processDirectRoutingOption(const char* line, Config* config) {
+    char value[16];
+    if (sscanf(line, "DirectRouting %15s", value) != 1) {
+        return -1;
+    }
+    if (strcmp(value, "on") == 0) {
+        config -> DirectRouting = 1;
+    } else if (strcmp(value, "off") == 0) {
+        config -> DirectRouting = 0;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// "Priority <type> <weight>": when all the types wait for the manager, it takes 'weight' articles of this type
+// for every 1 (the default weight) of the others.
+int processPriorityOption(const char* line, Config* config) {
+    char typeName[64];
+    int weight;
+    if (sscanf(line, "Priority %63s %d", typeName, &weight) != 2 || weight < 1) {
+        return -1;
+    }
+    int type = findArticleType(config, typeName);
+    if (type == -1) {
+        return -1;
+    }
+    config -> TypeWeights[type] = weight;
+    return 0;
+}
+
+// "Deadline <type> <milliseconds>": the articles of this type should be written at most this long after
+// their producer created them. The manager writes the most urgent articles first and counts the late ones.
+int processDeadlineOption(const char* line, Config* config) {
+    char typeName[64];
+    int milliseconds;
+    if (sscanf(line, "Deadline %63s %d", typeName, &milliseconds) != 2 || milliseconds < 1) {
+        return -1;
+    }
+    int type = findArticleType(config, typeName);
+    if (type == -1) {
+        return -1;
+    }
+    config -> TypeDeadlineMs[type] = milliseconds;
+    return 0;
+}
+
+// "Reorder <window> [timeoutMs]": the manager writes the articles of every producer and type in the order they
+// were created, holding up to 'window' articles for up to 'timeoutMs' milliseconds each (0 = off).
+int processReorderOption(const char* line, Config* config) {
+    int window;
+    int timeoutMs = REORDER_TIMEOUT_MS;
+    if (sscanf(line, "Reorder %d %d", &window, &timeoutMs) < 1 || window < 0 || timeoutMs < 0) {
+        return -1;
     }
-    return NewArray;
+    config -> ReorderWindow = window;
+    config -> ReorderTimeoutMs = timeoutMs;
+    return 0;
+}
+
+// "Journal <path> [syncMs]": the manager also appends every article to the journal file 'path' (see Journal.c),
+// and msyncs it every 'syncMs' milliseconds (0 = after every batch).
+int processJournalOption(const char* line, Config* config) {
+    char path[256];
+    int syncMs = JOURNAL_SYNC_MS;
+    int fields = sscanf(line, "Journal %255s %d", path, &syncMs);
+    if (fields < 1 || syncMs < 0) {
+        return -1;
+    }
+    char* copy = strdup(path);
+    if (copy == NULL) {
+        perror("Failed to allocate memory for the journal path");
+        return -1;
+    }
+    free(config -> JournalPath);
+    config -> JournalPath = copy;
+    config -> JournalSyncMs = syncMs;
+    return 0;
+}
+
+// "Types <name> <name> ...": the article types (instead of Sports, News and Weather), in the order of their index.
+// The first "Types" line replaces the default types, the next ones add more.
+int processTypesOption(const char* line, Config* config, int* replaced) {
+    if (!*replaced) {
+        for (int i = 0; i < config -> NumTypes; ++i) {
+            free(config -> Types[i]);
+        }
+        config -> NumTypes = 0;
+        *replaced = 1;
+    }
+    const char* next = line + strlen("Types");
+    char name[64];
+    int length;
+    int added = 0;
+    while (sscanf(next, "%63s%n", name, &length) == 1) {
+        next += length;
+        if (findArticleType(config, name) != -1 || config -> NumTypes == MAX_ARTICLE_TYPES) {
+            return -1; // Twice the same type, or more than an article can tell apart
+        }
+        char** grown = realloc(config -> Types, (config -> NumTypes + 1) * sizeof(char*));
+        char* copy = strdup(name);
+        if (grown == NULL || copy == NULL) {
+            perror("Failed to allocate memory for the types");
+            free(copy);
+            if (grown != NULL) {
+                config -> Types = grown;
+            }
+            return -1;
+        }
+        config -> Types = grown;
+        config -> Types[config -> NumTypes++] = copy;
+        added++;
+    }
+    return added > 0 ? 0 : -1;
+}
+
+// Allocate the settings that have a value per type, with their defaults (once the types are known).
+int allocateTypeOptions(Config* config) {
+    config -> CoEditorWorkers = malloc(config -> NumTypes * sizeof(int));
+    config -> TypeWeights = malloc(config -> NumTypes * sizeof(int));
+    config -> TypeDeadlineMs = malloc(config -> NumTypes * sizeof(int));
+    if (config -> CoEditorWorkers == NULL || config -> TypeWeights == NULL || config -> TypeDeadlineMs == NULL) {
+        perror("Failed to allocate memory for config");
+        return -1;
+    }
+    for (int i = 0; i < config -> NumTypes; ++i) {
+        config -> CoEditorWorkers[i] = 1;
+        config -> TypeWeights[i] = 1;
+        config -> TypeDeadlineMs[i] = 0;
+    }
+    return 0;
+}
+
+// "DispatcherQueueLimit <n>": max articles waiting in each dispatcher queue (0 = no limit).
+int processDispatcherQueueLimitOption(const char* line, Config* config) {
+    int limit;
+    if (sscanf(line, "DispatcherQueueLimit %d", &limit) != 1 || limit < 0) {
+        return -1;
+    }
+    config -> DispatcherQueueLimit = limit;
+    return 0;
+}
+
+// "MemoryLimit <kilobytes>": max memory of the articles in flight (0 = no limit).
+int processMemoryLimitOption(const char* line, Config* config) {
+    int kilobytes;
+    if (sscanf(line, "MemoryLimit %d", &kilobytes) != 1 || kilobytes < 0) {
+        return -1;
+    }
+    config -> MemoryLimitKb = kilobytes;
+    return 0;
+}
+
+// After the co-editor queue size the file may hold optional settings, one per line: "<Name> <values...>".
+// Empty lines and lines starting with '#' are skipped.
+// The "Types" lines are read first (wherever they are), because the settings of a type need to know its index.
+int processConfigOptions(ConfigScanner* scanner, Config* config) {
+    char line[4096]; // A "Types" line may be long
+    char name[64];
+    ConfigScanner start = *scanner;
+    int replaced = 0;
+    int found;
+    while ((found = nextConfigLine(scanner, line, sizeof(line))) != 0) {
+        if (found == -1) {
+            fprintf(stderr, "Config line %d is too long\n", scanner -> line - 1);
+            return -1;
+        }
+        if (sscanf(line, "%63s", name) == 1 && strcmp(name, "Types") == 0 &&
+            processTypesOption(line, config, &replaced) != 0) {
+            fprintf(stderr, "Invalid config line %d: %s\n", scanner -> line - 1, line);
+            return -1;
+        }
+    }
+    if (allocateTypeOptions(config) != 0) {
+        return -1;
+    }
+    *scanner = start;
+    while (nextConfigLine(scanner, line, sizeof(line)) != 0) {
+        if (sscanf(line, "%63s", name) != 1 || name[0] == '#') {
+            continue; // Empty line or comment
+        }
+        int result = -1;
+        if (strcmp(name, "Types") == 0) {
+            result = 0; // Already read
+        } else if (strcmp(name, "CoEditors") == 0) {
+            result = processCoEditorsOption(line, config);
+        } else if (strcmp(name, "OutputFlush") == 0) {
+            result = processOutputFlushOption(line, config);
+        } else if (strcmp(name, "EditDelay") == 0) {
+            result = processEditDelayOption(line, config);
+        } else if (strcmp(name, "Tracing") == 0) {
+            result = processTracingOption(line, config);
+        } else if (strcmp(name, "WaitStrategy") == 0) {
+            result = processWaitStrategyOption(line, config);
+        } else if (strcmp(name, "ProducerWorkers") == 0) {
+            result = processProducerWorkersOption(line, config);
+        } else if (strcmp(name, "Dispatchers") == 0) {
+            result = processDispatchersOption(line, config);
+        } else if (strcmp(name, "ProducerProcesses") == 0) {
+            result = processProducerProcessesOption(line, config);
+        } else if (strcmp(name, "DirectRouting") == 0) {
+            result = processDirectRoutingOption(line, config);
+        } else if (strcmp(name, "Affinity") == 0) {
+            result = processAffinityOption(line, config);
+        } else if (strcmp(name, "AsyncEdits") == 0) {
+            result = processAsyncEditsOption(line, config);
+        } else if (strcmp(name, "DispatcherQueueLimit") == 0) {
+            result = processDispatcherQueueLimitOption(line, config);
+        } else if (strcmp(name, "MemoryLimit") == 0) {
+            result = processMemoryLimitOption(line, config);
+        } else if (strcmp(name, "Journal") == 0) {
+            result = processJournalOption(line, config);
+        } else if (strcmp(name, "Reorder") == 0) {
+            result = processReorderOption(line, config);
+        } else if (strcmp(name, "Priority") == 0) {
+            result = processPriorityOption(line, config);
+        } else if (strcmp(name, "Deadline") == 0) {
+            result = processDeadlineOption(line, config);
+        }
+        if (result != 0) {
+            fprintf(stderr, "Invalid config line %d: %s\n", scanner -> line - 1, line);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Read the producers and the co-editor queue size into 'config'. Returns -1 (and says why) if they are not valid.
+int processConfigProducers(ConfigScanner* scanner, Config* config) {
+    // Every producer takes at least 6 bytes ("1 1 1" and a space), so this is as many as the file can hold.
+    size_t capacity = (scanner -> end - scanner -> next) / 6 + 1;
+    config -> ArrayProducers = malloc(capacity * sizeof(ProducerConfig));
+    if (config -> ArrayProducers == NULL) {
+        perror("Failed to allocate memory for ArrayProducers");
+        return -1;
+    }
+    config -> TotalNumProducers = 0;
+    int first;
+    int found = scanConfigNumber(scanner, &first);
+    int firstLine = scanner -> line;
+    while (found == 1) {
+        // 'first' is the id of a producer, unless it is the last number: then it is the co-editor queue size.
+        ConfigScanner options = *scanner;
+        int NumArticles, QueueLength;
+        int settings = scanConfigNumber(scanner, &NumArticles);
+        if (settings == 0) {
+            *scanner = options;
+            break;
+        }
+        if (settings == -1 || scanConfigNumber(scanner, &QueueLength) != 1) {
+            fprintf(stderr, "Invalid config line %d: expected the settings of producer %d\n", scanner -> line, first);
+            return -1;
+        }
+        int index = config -> TotalNumProducers;
+        if (first != index + 1) {
+            fprintf(stderr, "Invalid config line %d: expected producer %d, found %d\n", firstLine, index + 1, first);
+            return -1;
+        }
+        if (QueueLength < 1) {
+            fprintf(stderr, "Invalid config line %d: producer %d needs a queue size of at least 1\n", scanner -> line,
+                    first);
+            return -1;
+        }
+        // The ID of the producer starts from 1 in the file, and from 0 in the program.
+        config -> ArrayProducers[index].id = index;
+        config -> ArrayProducers[index].NumArticles = NumArticles;
+        config -> ArrayProducers[index].QueueLength = QueueLength;
+        config -> TotalNumProducers++;
+        found = scanConfigNumber(scanner, &first);
+        firstLine = scanner -> line;
+    }
+    if (found == -1) {
+        fprintf(stderr, "Invalid config line %d: broken number\n", scanner -> line);
+        return -1;
+    }
+    if (found != 1 || config -> TotalNumProducers == 0) {
+        fprintf(stderr, "Invalid config line %d: expected producers and then the co-editor queue size\n",
+                scanner -> line);
+        return -1;
+    }
+    if (first < 1) {
+        fprintf(stderr, "Invalid config line %d: the co-editor queue size must be at least 1\n", scanner -> line);
+        return -1;
+    }
+    config -> QueueLengthCoEditor = first;
+    return 0;
+}
+
+// Reject the options that can't be used together, instead of quietly dropping one. Returns -1 (and says why).
+int checkConfigOptions(Config* config) {
+    if (!config -> DirectRouting) {
+        return 0;
+    }
+    // The lanes are not in the shared memory, producer processes can only write to a dispatcher.
+    if (config -> ProducerProcesses) {
+        fprintf(stderr, "Invalid config: DirectRouting can't be used with ProducerProcesses\n");
+        return -1;
+    }
+    // A direct co-editor reads its lanes itself, it has no queue to keep the edits in flight for.
+    if (config -> AsyncEdits > 0) {
+        fprintf(stderr, "Invalid config: DirectRouting can't be used with AsyncEdits\n");
+        return -1;
+    }
+    return 0;
 }
 
 Config* processConfig(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (file == NULL) {
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
         perror("Failed to open file");
         return NULL;
     }
-    // The configuration for each producer will be stored in a dynamically
-    // allocated array, which we'll resize as needed. Start with space for
-    // one producer.
-    int capacity = 1;
-    Producer* ArrayProducers = malloc(capacity * sizeof(Producer));
-    if (ArrayProducers == NULL) {
-        perror("Failed to allocate memory for ArrayProducers");
-        exit(-1);
-    }
-    int tempNumPrducer = 0, NumArticles, QueueLength, TotalNumProducers;
-
-    // Each line correspond to
-    do {
-        // If the array is full, double its size
-        if (tempNumPrducer >= capacity) {
-            capacity *= 2;
-            ArrayProducers = reallocateProducers(ArrayProducers, capacity);
-            if (ArrayProducers == NULL) {
-                exit(-1);
-            }
-        }
-        // Store this producer's attributes.
-        // we use 'num_producers-1' because the ID of the producer starts from 1 and the array starts from zero.
-        // Also, producer id start from zero and not from 1.
-        ArrayProducers[tempNumPrducer-1].id = tempNumPrducer-1;
-        ArrayProducers[tempNumPrducer-1].NumArticles = NumArticles;
-        ArrayProducers[tempNumPrducer-1].QueueLength = QueueLength;
-        TotalNumProducers = tempNumPrducer;
-    } while (fscanf(file, "%d\n%d\n%d\n", &tempNumPrducer, &NumArticles, &QueueLength) == 3);
-
-    // The last number read is the co-editor queue size, not the ID of a producer
-    int QueueLengthCoEditor = tempNumPrducer;
-    fclose(file);
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        perror("Failed to read file");
+        close(fd);
+        return NULL;
+    }
+    if (status.st_size == 0) {
+        fprintf(stderr, "The config file is empty\n");
+        close(fd);
+        return NULL;
+    }
+    char* text = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file
+    if (text == MAP_FAILED) {
+        perror("Failed to map file");
+        return NULL;
+    }
+    madvise(text, status.st_size, MADV_SEQUENTIAL); // Read once, front to back
+    ConfigScanner scanner = {text, text + status.st_size, 1};
     Config* config = malloc(sizeof(Config));
     if (config == NULL) {
         perror("Failed to allocate memory for config");
-        free(ArrayProducers);
+        munmap(text, status.st_size);
+        return NULL;
+    }
+    // Defaults of the optional settings (the per-type ones are allocated once the "Types" lines are read)
+    config -> CoEditorWorkers = NULL;
+    config -> TypeWeights = NULL;
+    config -> TypeDeadlineMs = NULL;
+    config -> Types = NULL;
+    config -> NumTypes = 0;
+    config -> OutputFlushBytes = OUTPUT_FLUSH_BYTES;
+    config -> OutputFlushMs = OUTPUT_FLUSH_MS;
+    config -> EditDelayUsec = EDIT_DELAY_USEC;
+    config -> Tracing = 0;
+    for (int i = 0; i < NUM_QUEUE_STAGES; ++i) {
+        config -> WaitStrategies[i] = WAIT_BLOCKING;
+    }
+    config -> ProducerWorkers = 0;
+    config -> Dispatchers = 1;
+    config -> AsyncEdits = 0;
+    config -> DispatcherQueueLimit = 0;
+    config -> MemoryLimitKb = 0;
+    config -> AutoAffinity = 0;
+    config -> ProducerProcesses = 0;
+    config -> DirectRouting = 0;
+    config -> ArrayProducers = NULL;
+    config -> JournalPath = NULL;
+    config -> JournalSyncMs = JOURNAL_SYNC_MS;
+    config -> ReorderWindow = 0;
+    config -> ReorderTimeoutMs = REORDER_TIMEOUT_MS;
+    for (int i = 0; i < NUM_THREAD_STAGES; ++i) {
+        config -> StagePinned[i] = 0;
+        CPU_ZERO(&config -> StageCpus[i]);
+    }
+    // The types are Sports, News and Weather unless the config says otherwise
+    config -> Types = malloc(DEFAULT_NUM_ARTICLE_TYPES * sizeof(char*));
+    if (config -> Types == NULL) {
+        perror("Failed to allocate memory for config");
+        munmap(text, status.st_size);
+        cleanConfig(config);
+        return NULL;
+    }
+    for (int i = 0; i < DEFAULT_NUM_ARTICLE_TYPES; ++i) {
+        config -> Types[i] = strdup(defaultTypes[i]);
+        if (config -> Types[i] == NULL) {
+            perror("Failed to allocate memory for config");
+            munmap(text, status.st_size);
+            cleanConfig(config);
+            return NULL;
+        }
+        config -> NumTypes++;
+    }
+    // The producers, and the optional settings after the co-editor queue size
+    int result = processConfigProducers(&scanner, config);
+    if (result == 0) {
+        result = processConfigOptions(&scanner, config);
+    }
+    munmap(text, status.st_size);
+    if (result == 0) {
+        result = checkConfigOptions(config);
+    }
+    if (result != 0) {
+        cleanConfig(config);
         return NULL;
     }
-    config -> ArrayProducers = ArrayProducers;
-    config -> TotalNumProducers =TotalNumProducers;  // subtract one because the last number was the co-editor queue size
-    config -> QueueLengthCoEditor = QueueLengthCoEditor;
     return config;
 }
 
 void cleanConfig(Config* config) {
     if (config != NULL) {
         free(config -> ArrayProducers);  // Free the array of Producers
+        free(config -> JournalPath);
+        if (config -> Types != NULL) {
+            for (int i = 0; i < config -> NumTypes; ++i) {
+                free(config -> Types[i]);
+            }
+            free(config -> Types);
+        }
+        free(config -> CoEditorWorkers);
+        free(config -> TypeWeights);
+        free(config -> TypeDeadlineMs);
         free(config);  // Free the Config itself
     }
 }
\ No newline at end of file
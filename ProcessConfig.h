@@ -2,7 +2,32 @@
 #ifndef TASK3_PROCESSCONFIG_H
 #define TASK3_PROCESSCONFIG_H
 #include "Structs.h"
-Producer* reallocateProducers(Producer* OldArray, int capacity);
+void skipConfigSpaces(ConfigScanner* scanner);
+int scanConfigNumber(ConfigScanner* scanner, int* value);
+int nextConfigLine(ConfigScanner* scanner, char* line, size_t size);
+int findArticleType(const Config* config, const char* name);
+int processCoEditorsOption(const char* line, Config* config);
+int processOutputFlushOption(const char* line, Config* config);
+int processEditDelayOption(const char* line, Config* config);
+int processTracingOption(const char* line, Config* config);
+int processWaitStrategyOption(const char* line, Config* config);
+int processProducerWorkersOption(const char* line, Config* config);
+int processDispatchersOption(const char* line, Config* config);
+int processProducerProcessesOption(const char* line, Config* config);
+int processDirectRoutingOption(const char* line, Config* config);
+int processAffinityOption(const char* line, Config* config);
+int processAsyncEditsOption(const char* line, Config* config);
+int processPriorityOption(const char* line, Config* config);
+int processDeadlineOption(const char* line, Config* config);
+int processReorderOption(const char* line, Config* config);
+int processJournalOption(const char* line, Config* config);
+int processTypesOption(const char* line, Config* config, int* replaced);
+int allocateTypeOptions(Config* config);
+int processDispatcherQueueLimitOption(const char* line, Config* config);
+int processMemoryLimitOption(const char* line, Config* config);
+int processConfigOptions(ConfigScanner* scanner, Config* config);
+int processConfigProducers(ConfigScanner* scanner, Config* config);
+int checkConfigOptions(Config* config);
 Config* processConfig(const char* filename);
 void cleanConfig(Config* config);
 #endif //TASK3_PROCESSCONFIG_H
@@ -1,21 +1,112 @@
 # include "Producer.h"
 
-// This function defines the operation of a Producer thread.
-void* producerThread(void* arg) {
+// Reset the task state of a producer (before it runs for the first time).
+void initProducerTask(Producer* producer) {
+    producer -> produced = 0;
+    for (int i = 0; i < numArticleTypes; ++i) {
+        producer -> articleCounts[i] = 0;
+    }
+    producer -> batchCount = 0;
+    producer -> batchSent = 0;
+    producer -> sentDone = 0;
+    producer -> doneLanes = 0;
+    atomic_init(&producer -> taskState, TASK_RUNNING);
+    producer -> nextTask = NULL;
+}
+
+// Create the next batch of articles (or the "DONE" message once all the articles were created).
+// Returns how many articles were created, the batch is cut short when the pool is out of credits.
+int createProducerBatch(Producer* producer) {
+    if (producer -> produced == producer -> NumArticles) {
+        // After all articles are produced, insert a "DONE" message to signal to the dispatcher the end of production.
+        // With direct routing it is sent to every lane, one after the other (see sendProducerBatch).
+        producer -> batchCount = 1;
+        producer -> batch[0] = &DoneArticle;
+        producer -> sentDone = 1;
+        return 0;
+    }
+    // Articles are inserted PRODUCER_BATCH at a time, so the buffer is published once per batch.
+    while (producer -> batchCount < PRODUCER_BATCH && producer -> produced < producer -> NumArticles) {
+        // Take memory for the article that will be inserted in the buffer from the producer's pool.
+        Article* article = tryAllocateArticle(producer -> pool);
+        if (article == NULL) {
+            break; // Wait until the manager gives some articles back
+        }
+        int i = rand() % numArticleTypes; // Choose a random type for the article.
+        article -> producerId = producer -> id;
+        article -> type = i;
+        article -> sequence = producer -> articleCounts[i]++;
+        article -> flags = 0;
+        article -> stamps[STAMP_CREATED] = getMonotonicNs();
+        producer -> batch[producer -> batchCount++] = article;
+        producer -> produced += 1;
+    }
+    return producer -> batchCount;
+}
+
+// The buffer batch[i] goes to: the producer's buffer, or with direct routing the lane of its type.
+BoundedBuffer* producerBufferFor(Producer* producer, int i) {
+    if (producer -> ProducerBuffer != NULL) {
+        return producer -> ProducerBuffer;
+    }
+    return producer -> lanes[isDoneArticle(producer -> batch[i]) ? producer -> doneLanes : producer -> batch[i] -> type];
+}
+
+// Put as much of the batch as fits in the buffer(s), in order. Returns 1 if all of it is in.
+// Consecutive articles that go to the same buffer are inserted together.
+int sendProducerBatch(Producer* producer) {
+    while (producer -> batchSent < producer -> batchCount) {
+        BoundedBuffer* buffer = producerBufferFor(producer, producer -> batchSent);
+        int end = producer -> batchSent + 1;
+        while (end < producer -> batchCount && producerBufferFor(producer, end) == buffer) {
+            end++;
+        }
+        producer -> batchSent += tryInsertBoundedBufferBatch(buffer, producer -> batch + producer -> batchSent,
+                                                             end - producer -> batchSent);
+        if (producer -> batchSent < end) {
+            return 0;
+        }
+        // With direct routing the "DONE" goes again to the next lane, until every lane has it.
+        if (producer -> ProducerBuffer == NULL && producer -> sentDone && ++producer -> doneLanes < numArticleTypes) {
+            producer -> batchSent = 0;
+        }
+    }
+    return 1;
+}
 
-    Producer* producer = (Producer*)arg; // Cast the pointer to a Producer pointer, so we can access its properties.
-    // This array stores the number of articles of each type the producer has produced.
-    int articleCounts[NUM_ARTICLES_TYPES] = {0};
-    // The Producer creates articles until it reaches its max articles provided in the config file.
-    for (int j = 0; j < producer -> NumArticles; ++j) {
-        int i = rand() % NUM_ARTICLES_TYPES; // Choose a random type for the article.
-        // Allocate memory for the message that will be inserted in the buffer.
-        char* message = malloc(100);
-        sprintf(message, "Producer %d %s %d", producer -> id, types[i], articleCounts[i]++);
-        // Insert the message into the producer's buffer.
-        insertBoundedBuffer(producer -> ProducerBuffer, message);
+/*
+ * Run a producer until it used its quantum, its buffer is full, or it is done.
+ * It never blocks the worker thread: on a full buffer (or when its pool is out of credits) it arms the wakeup
+ * and returns PRODUCER_BLOCKED, and continues from the same place the next time it runs.
+ */
+ProducerStep runProducer(Producer* producer) {
+    int created = 0;
+    while (1) {
+        // First put in the buffer what we already created.
+        if (producer -> batchSent < producer -> batchCount) {
+            if (!sendProducerBatch(producer)) {
+                if (armBoundedBufferWriter(producerBufferFor(producer, producer -> batchSent))) {
+                    return PRODUCER_BLOCKED;
+                }
+                continue; // A slot was freed meanwhile
+            }
+            producer -> batchCount = 0;
+            producer -> batchSent = 0;
+        }
+        if (producer -> sentDone) {
+            return PRODUCER_FINISHED;
+        }
+        if (created >= PRODUCER_QUANTUM) {
+            return PRODUCER_YIELD;
+        }
+        int count = createProducerBatch(producer);
+        if (count == 0 && !producer -> sentDone) {
+            // All the articles of this producer are in flight.
+            if (armArticlePool(producer -> pool)) {
+                return PRODUCER_BLOCKED;
+            }
+            continue; // Some came back meanwhile
+        }
+        created += count;
     }
-    // After all articles are produced, insert a "DONE" message to signal to the dispatcher the end of production.
-    insertBoundedBuffer(producer -> ProducerBuffer, "DONE");
-    return NULL;
-}
\ No newline at end of file
+}
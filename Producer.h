@@ -2,5 +2,19 @@
 #ifndef TASK3_PRODUCER_H
 #define TASK3_PRODUCER_H
 #include "Structs.h"
-void* producerThread(void* arg);
+// Max number of articles a producer creates in a single run before it lets the next task run.
+#define PRODUCER_QUANTUM 64
+
+// Why runProducer returned.
+typedef enum {
+    PRODUCER_YIELD, // Used its quantum, run it again later
+    PRODUCER_BLOCKED, // Its buffer is full (the dispatcher will wake it) or its pool is empty (the manager will)
+    PRODUCER_FINISHED // Its "DONE" is in the buffer
+} ProducerStep;
+
+void initProducerTask(Producer* producer);
+int createProducerBatch(Producer* producer);
+BoundedBuffer* producerBufferFor(Producer* producer, int i);
+int sendProducerBatch(Producer* producer);
+ProducerStep runProducer(Producer* producer);
 #endif //TASK3_PRODUCER_H
@@ -0,0 +1,161 @@
+# include "ProducerProcess.h"
+#include <sys/wait.h>
+
+/*
+ * "ProducerProcesses on": every producer is a child process instead of a task of the producer workers.
+ * Its buffer, its article pool and the semaphores it posts are in a SharedArena that is mapped before the fork,
+ * so it writes its articles straight into shared memory and the dispatcher reads the very same pointers.
+ * A producer that crashes only takes its own articles down: the reaper thread notices it died before sending
+ * "DONE", and sends the "DONE" for it so the rest of the pipeline still finishes.
+ */
+
+// The shared memory the producer processes need: their buffers, pools and flags, and the dispatcher shards.
+size_t producerProcessesArenaSize(Config* config) {
+    int credits = producerCredits(config);
+    size_t size = 0;
+    for (int i = 0; i < config -> TotalNumProducers; ++i) {
+        int slab = articlePoolFirstSlab(config -> ArrayProducers[i].NumArticles, credits);
+        size += cacheAlignedSize(sizeof(BoundedBuffer));
+        size += cacheAlignedSize(boundedBufferCapacity(config -> ArrayProducers[i].QueueLength, BUFFER_SPSC) *
+                                 sizeof(Article*));
+        size += cacheAlignedSize(sizeof(ArticlePool));
+        size += cacheAlignedSize(sizeof(ArticleSlab) + slab * sizeof(ArticleBlock));
+    }
+    size += cacheAlignedSize(config -> TotalNumProducers * sizeof(atomic_int));
+    size += cacheAlignedSize(config -> TotalNumProducers * sizeof(sem_t));
+    size += cacheAlignedSize(config -> Dispatchers * sizeof(DispatcherShard));
+    // The ready set of every shard (split the same way as createDispatcher does)
+    int numShards = config -> Dispatchers < config -> TotalNumProducers ? config -> Dispatchers : config -> TotalNumProducers;
+    for (int s = 0; s < numShards; ++s) {
+        int count = config -> TotalNumProducers / numShards + (s < config -> TotalNumProducers % numShards);
+        size += cacheAlignedSize(readySetBytes(count));
+    }
+    return size;
+}
+
+// The pool's ownerWakeup in a producer process: the manager gave an article back.
+void wakeProducerProcess(void* arg) {
+    sem_post((sem_t*)arg);
+}
+
+// The body of a producer process: create all the articles and the "DONE", blocking when the buffer is full
+// or when all its articles are in flight.
+void runProducerProcess(Producer* producer, atomic_int* sentDone, sem_t* credits) {
+    initProducerTask(producer);
+    while (!producer -> sentDone) {
+        int count = createProducerBatch(producer);
+        if (count == 0 && !producer -> sentDone) {
+            if (armArticlePool(producer -> pool)) {
+                sem_wait(credits); // Until the manager gives an article back
+            }
+            continue;
+        }
+        insertBoundedBufferBatch(producer -> ProducerBuffer, producer -> batch, producer -> batchCount);
+        producer -> batchCount = 0;
+    }
+    atomic_store(sentDone, 1);
+}
+
+// Waits for the producer processes to exit, and sends "DONE" for every one that died before it did.
+void* producerReaperThread(void* arg) {
+    ProducerProcesses* processes = (ProducerProcesses*)arg;
+    int running = processes -> numProducers;
+    while (running > 0) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid == -1) {
+            perror("Failed to wait for the producer processes");
+            break;
+        }
+        for (int i = 0; i < processes -> numProducers; ++i) {
+            if (processes -> pids[i] != pid) {
+                continue;
+            }
+            processes -> pids[i] = 0;
+            running--;
+            if (!atomic_load(&processes -> sentDone[i])) {
+                // The process is gone, so we are now the only writer of its buffer.
+                Producer* producer = processes -> producers[i];
+                fprintf(stderr, "Producer %d died before it finished, the rest of its articles are lost\n",
+                        producer -> id);
+                processes -> crashed++;
+                atomic_store(&processes -> sentDone[i], 1);
+                // It may have died between publishing articles and marking its buffer in the shard's ready set
+                // (or between the mark and its wakeup), so the dispatcher may not know they are there.
+                // Make it look: it drains the buffer, so our "DONE" also finds room.
+                BoundedBuffer* buffer = producer -> ProducerBuffer;
+                forceMarkReadySet(buffer -> readySet, buffer -> readyIndex);
+                insertBoundedBuffer(buffer, &DoneArticle);
+            }
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Fork a process for every producer (pinned as 'placement' says) and start the reaper thread.
+// Must be called before any other thread of the pipeline exists. Returns NULL on error.
+ProducerProcesses* startProducerProcesses(Producer** producers, int numProducers, SharedArena* arena,
+                                          Placement* placement) {
+    ProducerProcesses* processes = malloc(sizeof(ProducerProcesses));
+    if (processes == NULL) {
+        perror("Failed to allocate memory for ProducerProcesses");
+        return NULL;
+    }
+    processes -> producers = producers;
+    processes -> numProducers = numProducers;
+    processes -> crashed = 0;
+    processes -> pids = calloc(numProducers > 0 ? numProducers : 1, sizeof(pid_t));
+    processes -> sentDone = allocateSharedArena(arena, numProducers * sizeof(atomic_int));
+    processes -> credits = allocateSharedArena(arena, numProducers * sizeof(sem_t));
+    if (processes -> pids == NULL || processes -> sentDone == NULL || processes -> credits == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the producer processes\n");
+        free(processes -> pids);
+        free(processes);
+        return NULL;
+    }
+    for (int i = 0; i < numProducers; ++i) {
+        atomic_init(&processes -> sentDone[i], 0);
+        sem_init(&processes -> credits[i], 1, 0); // pshared = 1, posted by the manager's process
+        producers[i] -> pool -> ownerWakeup = wakeProducerProcess;
+        producers[i] -> pool -> ownerWakeupArg = &processes -> credits[i];
+    }
+    // Anything still buffered would be written again by every child.
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = 0; i < numProducers; ++i) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            perror("Failed to fork a producer process");
+            exit(-1);
+        }
+        if (pid == 0) {
+            // The child starts with a copy of the parent's rand() state: without a seed of its own
+            // every producer process would choose the very same sequence of types.
+            srand((unsigned int)time(NULL) ^ (unsigned int)producers[i] -> id ^ (unsigned int)getpid());
+            placeThread(placement, STAGE_PRODUCERS, i, pthread_self());
+            runProducerProcess(producers[i], &processes -> sentDone[i], &processes -> credits[i]);
+            _exit(0); // Don't run the parent's exit handlers or flush its stdio
+        }
+        processes -> pids[i] = pid;
+    }
+    pthread_create(&processes -> reaper, NULL, producerReaperThread, processes);
+    return processes;
+}
+
+// Wait until every producer process exited (or died and was replaced by its "DONE").
+void joinProducerProcesses(ProducerProcesses* processes) {
+    pthread_join(processes -> reaper, NULL);
+}
+
+// Destructor for ProducerProcesses (after joinProducerProcesses). The arena owns the shared parts.
+void destructorProducerProcesses(ProducerProcesses* processes) {
+    if (processes == NULL) {
+        return;
+    }
+    for (int i = 0; i < processes -> numProducers; ++i) {
+        sem_destroy(&processes -> credits[i]);
+    }
+    free(processes -> pids);
+    free(processes);
+}
@@ -0,0 +1,12 @@
+#pragma once
+#ifndef TASK3_PRODUCERPROCESS_H
+#define TASK3_PRODUCERPROCESS_H
+#include "Structs.h"
+size_t producerProcessesArenaSize(Config* config);
+void wakeProducerProcess(void* arg);
+void runProducerProcess(Producer* producer, atomic_int* sentDone, sem_t* credits);
+ProducerProcesses* startProducerProcesses(Producer** producers, int numProducers, SharedArena* arena,
+                                          Placement* placement);
+void joinProducerProcesses(ProducerProcesses* processes);
+void destructorProducerProcesses(ProducerProcesses* processes);
+#endif //TASK3_PRODUCERPROCESS_H
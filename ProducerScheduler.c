@@ -0,0 +1,167 @@
+# include "ProducerScheduler.h"
+
+/*
+ * M:N producers. Instead of a thread per producer (a stack and a scheduler entry each, most of them asleep
+ * on a full buffer), the producers are tasks that a fixed number of worker threads run from a run queue.
+ * A task that finds its buffer full doesn't block the worker: it arms the buffer's writer wakeup and parks,
+ * and the dispatcher puts it back in the run queue when it frees a slot of that buffer.
+ * The same goes for a task whose article pool is out of credits: the manager wakes it when it returns an article.
+ *
+ * taskState makes sure a task is never in the run queue twice and that no wakeup is lost:
+ * the worker parks a task only with RUNNING -> PARKED, and a wakeup that comes while the task is still
+ * running turns RUNNING into NOTIFIED, so the worker runs it again instead of parking it.
+ */
+
+// Add a task to the end of the run queue and wake a worker.
+void pushProducerTask(ProducerScheduler* scheduler, Producer* producer) {
+    producer -> nextTask = NULL;
+    sem_wait(&scheduler -> mutexSemaphore); // Enter critical section
+    if (scheduler -> tail == NULL) {
+        scheduler -> head = producer;
+    } else {
+        scheduler -> tail -> nextTask = producer;
+    }
+    scheduler -> tail = producer;
+    sem_post(&scheduler -> mutexSemaphore); // Exit critical section
+    postSemaphore(&scheduler -> readySemaphore, 1);
+}
+
+// Take the first task of the run queue (NULL if it is empty). The caller already took one readySemaphore.
+Producer* popProducerTask(ProducerScheduler* scheduler) {
+    sem_wait(&scheduler -> mutexSemaphore); // Enter critical section
+    Producer* producer = scheduler -> head;
+    if (producer != NULL) {
+        scheduler -> head = producer -> nextTask;
+        if (scheduler -> head == NULL) {
+            scheduler -> tail = NULL;
+        }
+    }
+    sem_post(&scheduler -> mutexSemaphore); // Exit critical section
+    return producer;
+}
+
+// Called by the dispatcher (as the buffer's writerWakeup) when it freed a slot the producer waits for.
+void wakeProducerTask(void* arg) {
+    Producer* producer = (Producer*)arg;
+    int state = atomic_load(&producer -> taskState);
+    while (1) {
+        if (state == TASK_PARKED) {
+            if (atomic_compare_exchange_weak(&producer -> taskState, &state, TASK_RUNNING)) {
+                pushProducerTask(producer -> scheduler, producer);
+                return;
+            }
+        } else if (state == TASK_RUNNING) {
+            if (atomic_compare_exchange_weak(&producer -> taskState, &state, TASK_NOTIFIED)) {
+                return;
+            }
+        } else {
+            return; // Already notified, or done
+        }
+    }
+}
+
+// The last task finished: stop every worker (each one takes a post and finds the run queue empty).
+void stopProducerWorkers(ProducerScheduler* scheduler) {
+    postSemaphore(&scheduler -> readySemaphore, scheduler -> numWorkers);
+}
+
+// A worker thread: run tasks from the run queue until all of them finished.
+void* producerWorkerThread(void* arg) {
+    ProducerScheduler* scheduler = (ProducerScheduler*)arg;
+    STATS_THREAD_START("producers", atomic_fetch_add(&scheduler -> workersStarted, 1));
+    while (1) {
+        waitSemaphore(&scheduler -> readySemaphore, 0);
+        Producer* producer = popProducerTask(scheduler);
+        if (producer == NULL) {
+            break; // All the tasks finished
+        }
+        // Any wakeup from before this run is stale, the task will look at its buffer anyway.
+        atomic_store(&producer -> taskState, TASK_RUNNING);
+        ProducerStep step = runProducer(producer);
+        if (step == PRODUCER_FINISHED) {
+            atomic_store(&producer -> taskState, TASK_FINISHED);
+            if (atomic_fetch_sub(&scheduler -> tasksLeft, 1) == 1) {
+                stopProducerWorkers(scheduler);
+            }
+            continue;
+        }
+        if (step == PRODUCER_BLOCKED) {
+            int state = TASK_RUNNING;
+            if (atomic_compare_exchange_strong(&producer -> taskState, &state, TASK_PARKED)) {
+                continue; // The dispatcher will push it back
+            }
+            // It was woken while it ran, so it can continue right away.
+        }
+        pushProducerTask(scheduler, producer);
+    }
+    STATS_THREAD_END();
+    return NULL;
+}
+
+// Constructor of a Producer Scheduler. Starts 'numWorkers' threads (0 = one per CPU) that run all the producers.
+// The threads are pinned as 'placement' says (may be NULL).
+ProducerScheduler* constructorProducerScheduler(Producer** producers, int numProducers, int numWorkers,
+                                                Placement* placement) {
+    ProducerScheduler* scheduler = malloc(sizeof(ProducerScheduler));
+    if (scheduler == NULL) {
+        perror("Failed to allocate memory for ProducerScheduler");
+        exit(-1);
+    }
+    if (numWorkers <= 0) {
+        numWorkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (numWorkers > numProducers) {
+        numWorkers = numProducers; // A worker runs a single task at a time
+    }
+    if (numWorkers < 1) {
+        numWorkers = 1;
+    }
+    scheduler -> head = NULL;
+    scheduler -> tail = NULL;
+    scheduler -> numWorkers = numWorkers;
+    sem_init(&scheduler -> mutexSemaphore, 0, 1);
+    initSemaphore(&scheduler -> readySemaphore, 0, 0);
+    atomic_init(&scheduler -> tasksLeft, numProducers);
+    atomic_init(&scheduler -> workersStarted, 0);
+    for (int i = 0; i < numProducers; ++i) {
+        initProducerTask(producers[i]);
+        producers[i] -> scheduler = scheduler;
+        // Its buffer, or with direct routing its lanes
+        int numBuffers = producers[i] -> ProducerBuffer != NULL ? 1 : numArticleTypes;
+        for (int j = 0; j < numBuffers; ++j) {
+            BoundedBuffer* buffer = producers[i] -> ProducerBuffer != NULL ? producers[i] -> ProducerBuffer
+                                                                            : producers[i] -> lanes[j];
+            buffer -> writerWakeup = wakeProducerTask;
+            buffer -> writerWakeupArg = producers[i];
+        }
+        producers[i] -> pool -> ownerWakeup = wakeProducerTask;
+        producers[i] -> pool -> ownerWakeupArg = producers[i];
+        pushProducerTask(scheduler, producers[i]);
+    }
+    if (numProducers == 0) {
+        stopProducerWorkers(scheduler);
+    }
+    scheduler -> workers = malloc(numWorkers * sizeof(pthread_t));
+    for (int i = 0; i < numWorkers; ++i) {
+        pthread_create(&scheduler -> workers[i], NULL, producerWorkerThread, scheduler);
+        placeThread(placement, STAGE_PRODUCERS, i, scheduler -> workers[i]);
+    }
+    return scheduler;
+}
+
+// Wait until all the producers finished.
+void joinProducerScheduler(ProducerScheduler* scheduler) {
+    for (int i = 0; i < scheduler -> numWorkers; ++i) {
+        pthread_join(scheduler -> workers[i], NULL);
+    }
+}
+
+// Destructor for ProducerScheduler (after joinProducerScheduler).
+void destructorProducerScheduler(ProducerScheduler* scheduler) {
+    if (scheduler == NULL) {
+        return;
+    }
+    sem_destroy(&scheduler -> mutexSemaphore);
+    free(scheduler -> workers);
+    free(scheduler);
+}
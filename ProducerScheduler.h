@@ -0,0 +1,10 @@
+#pragma once
+#ifndef TASK3_PRODUCERSCHEDULER_H
+#define TASK3_PRODUCERSCHEDULER_H
+#include "Structs.h"
+ProducerScheduler* constructorProducerScheduler(Producer** producers, int numProducers, int numWorkers,
+                                                Placement* placement);
+void wakeProducerTask(void* arg);
+void joinProducerScheduler(ProducerScheduler* scheduler);
+void destructorProducerScheduler(ProducerScheduler* scheduler);
+#endif //TASK3_PRODUCERSCHEDULER_H
@@ -1,120 +1,984 @@
 # include "Queue.h"
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
 
-// Constructor of Bounded Buffer.
-BoundedBuffer* constructorBoundedBuffer(int size) {
+// Tell the CPU we are busy waiting (lets the other hyper-thread run and saves power), without leaving the CPU.
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// How many times WAIT_ADAPTIVE spins before it yields. Spinning only helps when the other side runs at the
+// same time on another CPU, so with a single CPU we go straight to yielding.
+int waitSpinIterations() {
+    static atomic_int iterations = -1;
+    int value = atomic_load_explicit(&iterations, memory_order_relaxed);
+    if (value == -1) {
+        value = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? WAIT_SPIN_ITERATIONS : 0;
+        atomic_store_explicit(&iterations, value, memory_order_relaxed);
+    }
+    return value;
+}
+
+// Sleep while '*word' is 'expected' (until 'deadlineNs' on the monotonic clock if it is not 0, or until woken).
+// Only process-private memory unless 'shared'. May return early, the caller checks its condition again.
+void futexWait(atomic_uint* word, unsigned int expected, long long deadlineNs, int shared) {
+    int op = FUTEX_WAIT_BITSET | (shared ? 0 : FUTEX_PRIVATE_FLAG);
+    struct timespec deadline = {deadlineNs / 1000000000LL, deadlineNs % 1000000000LL};
+    syscall(SYS_futex, word, op, expected, deadlineNs != 0 ? &deadline : NULL, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+// Wake up to 'count' threads sleeping in futexWait on 'word'.
+void futexWake(atomic_uint* word, int count, int shared) {
+    syscall(SYS_futex, word, FUTEX_WAKE | (shared ? 0 : FUTEX_PRIVATE_FLAG), count, NULL, NULL, 0);
+}
+
+/*
+ * BatchSemaphore.
+ * The value is a plain atomic counter: a post of n articles is one atomic add, and a reader takes all it wants
+ * (up to 'max') with one compare-and-swap. Only a thread that finds it at 0 sleeps, on a futex on the value
+ * itself, and a post only makes the futex syscall when 'waiters' says someone sleeps.
+ */
+
+void initSemaphore(BatchSemaphore* semaphore, unsigned int value, int shared) {
+    atomic_init(&semaphore -> value, value);
+    atomic_init(&semaphore -> waiters, 0);
+    semaphore -> shared = shared;
+}
+
+// Take up to 'max' units of a semaphore without blocking. Returns how many were taken.
+int tryWaitSemaphore(BatchSemaphore* semaphore, int max) {
+    unsigned int value = atomic_load_explicit(&semaphore -> value, memory_order_relaxed);
+    while (value > 0 && max > 0) {
+        unsigned int count = value < (unsigned int)max ? value : (unsigned int)max;
+        // On failure 'value' is reloaded and we try again
+        if (atomic_compare_exchange_weak_explicit(&semaphore -> value, &value, value - count, memory_order_acquire,
+                                                  memory_order_relaxed)) {
+            return count;
+        }
+    }
+    return 0;
+}
+
+// Add 'count' units at once, and wake the sleepers if there are any.
+void postSemaphore(BatchSemaphore* semaphore, int count) {
+    if (count <= 0) {
+        return;
+    }
+    atomic_fetch_add(&semaphore -> value, count);
+    // Both sides use sequentially consistent operations: either we see the waiter, or it sees the new value.
+    if (atomic_load(&semaphore -> waiters) > 0) {
+        futexWake(&semaphore -> value, count, semaphore -> shared);
+    }
+}
+
+// Returns how many units (up to 'max') could be taken while spinning and yielding, 0 if it is time to sleep.
+int spinSemaphore(BatchSemaphore* semaphore, int max) {
+    int spins = waitSpinIterations();
+    int count;
+    for (int i = 0; i < spins; ++i) {
+        cpuRelax();
+        if ((count = tryWaitSemaphore(semaphore, max)) > 0) {
+            return count;
+        }
+    }
+    for (int i = 0; i < WAIT_YIELD_ITERATIONS; ++i) {
+        sched_yield();
+        if ((count = tryWaitSemaphore(semaphore, max)) > 0) {
+            return count;
+        }
+    }
+    return 0;
+}
+
+// The blocking part of waitSemaphoreBatch.
+int sleepSemaphore(BatchSemaphore* semaphore, int max, long long deadlineNs) {
+    atomic_fetch_add(&semaphore -> waiters, 1);
+    int count;
+    while ((count = tryWaitSemaphore(semaphore, max)) == 0) {
+        if (deadlineNs != 0 && getMonotonicNs() >= deadlineNs) {
+            break;
+        }
+        // The kernel only puts us to sleep if the value is still 0, so a post in between is never missed.
+        futexWait(&semaphore -> value, 0, deadlineNs, semaphore -> shared);
+    }
+    atomic_fetch_sub(&semaphore -> waiters, 1);
+    return count;
+}
+
+/*
+ * Take between 1 and 'max' units, sleeping while there are none. Gives up at 'deadlineNs' (monotonic clock),
+ * a deadline of 0 means wait forever.
+ * With WAIT_ADAPTIVE we first spin (pause) and yield, and only then sleep, so an article that arrives while we
+ * spin costs no syscall on either side, and no context switch.
+ * Returns how many units were taken (0 if the deadline passed first).
+ */
+int waitSemaphoreBatch(BatchSemaphore* semaphore, int max, long long deadlineNs, WaitStrategy strategy) {
+    int count = tryWaitSemaphore(semaphore, max);
+    if (count > 0) {
+        return count;
+    }
+    if (strategy == WAIT_ADAPTIVE && (count = spinSemaphore(semaphore, max)) > 0) {
+        return count;
+    }
+#ifdef INSTRUMENT
+    // Only count the waits that really sleep, and how long they slept.
+    long long start = getMonotonicNs();
+    count = sleepSemaphore(semaphore, max, deadlineNs);
+    STATS_BLOCKED(getMonotonicNs() - start);
+    return count;
+#else
+    return sleepSemaphore(semaphore, max, deadlineNs);
+#endif
+}
+
+// Take a single unit. Returns 1 if we took it and 0 if the deadline passed first.
+int waitSemaphoreWith(BatchSemaphore* semaphore, long long deadlineNs, WaitStrategy strategy) {
+    return waitSemaphoreBatch(semaphore, 1, deadlineNs, strategy);
+}
+
+// waitSemaphoreWith, sleeping right away.
+int waitSemaphore(BatchSemaphore* semaphore, long long deadlineNs) {
+    return waitSemaphoreWith(semaphore, deadlineNs, WAIT_BLOCKING);
+}
+
+// The number of slots a buffer of 'size' articles has. The SPSC and MPSC rings round it up to a power of two: their
+// positions wrap around at 2^32, which is only a whole number of laps when the ring length divides it.
+int boundedBufferCapacity(int size, BufferKind kind) {
+    if (kind == BUFFER_LOCKED) {
+        return size;
+    }
+    int capacity = 1;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+// Allocate and initialize a Bounded Buffer of the given kind.
+BoundedBuffer* createBoundedBuffer(int size, BufferKind kind) {
     // Allocate memory for a BounderBuffer struct and store a pointer it.
-    BoundedBuffer* buffer = malloc(sizeof(BoundedBuffer));
+    // It is aligned to a cache line so the SPSC indices really sit on separate lines.
+    BoundedBuffer* buffer = aligned_alloc(CACHE_LINE_SIZE, sizeof(BoundedBuffer));
     if (buffer == NULL) {
         perror("Failed to allocate memory for BoundedBuffer");
         return NULL;
     }
-    // Define the size of the buffer array within the BoundedBuffer structure (buffer is an array of char pointers)
-    buffer -> buffer = malloc(size * sizeof(char*));
+    // Define the size of the buffer array within the BoundedBuffer structure (buffer is an array of Article pointers)
+    Article** slots = malloc(boundedBufferCapacity(size, kind) * sizeof(Article*));
+    atomic_uint* sequences = kind == BUFFER_MPSC ? malloc(boundedBufferCapacity(size, kind) * sizeof(atomic_uint)) : NULL;
+    initBoundedBuffer(buffer, slots, sequences, size, kind, 0);
+    return buffer;
+}
+
+/*
+ * Initialize a Bounded Buffer in memory the caller gave ('sequences' is only used by BUFFER_MPSC).
+ * With 'shared' set its semaphores are process-shared, so it can live in a SharedArena.
+ */
+void initBoundedBuffer(BoundedBuffer* buffer, Article** slots, atomic_uint* sequences, int size, BufferKind kind,
+                       int shared) {
+    int capacity = boundedBufferCapacity(size, kind);
+    buffer -> buffer = slots;
     // Iterate over all the cells in the buffer and init them with null value.
-    for (int i = 0; i < size; ++i) {
+    for (int i = 0; i < capacity; ++i) {
         buffer -> buffer[i] = NULL;
     }
     buffer -> size = size;
+    buffer -> mask = (unsigned int)capacity - 1;
     buffer -> in = 0;
     buffer -> out = 0;
-    // 'pshared' is set to 0, the semaphore is shared between threads of the same process.
+    buffer -> kind = kind;
+    buffer -> waitStrategy = WAIT_BLOCKING;
+    buffer -> shared = shared;
+    buffer -> borrowed = shared;
+    buffer -> sequences = NULL;
+    if (kind == BUFFER_MPSC) {
+        // Slot i is first written by the writer that claims position i.
+        buffer -> sequences = sequences;
+        for (int i = 0; i < capacity; ++i) {
+            atomic_init(&buffer -> sequences[i], 2 * i); // Free for the first lap
+        }
+    }
+    // 'pshared' is set to 0, the semaphore is shared between threads of the same process
+    // (or to 1 in shared memory, the semaphore is then shared between processes).
     // 'value' is set to 1 = mutex lock ->  Only one thread can "own" this lock at a time.
     // When value is 1 indicates that the lock is available,
     // while a value of 0 would indicate that the lock is not available
-    sem_init(&buffer -> mutexSemaphore, 0, 1);
+    sem_init(&buffer -> mutexSemaphore, shared, 1);
     // initialized to the size of the buffer (indicating that all slots are initially free).
-    sem_init(&buffer -> slotsSemaphore, 0, size);
+    // In the SPSC ring the free slots are counted by the indices, the semaphore is only used to sleep on.
+    // The MPSC slots know by themselves if they are free (see claimMpscBuffer), it is not used at all.
+    initSemaphore(&buffer -> slotsSemaphore, kind == BUFFER_LOCKED ? size : 0, shared);
     // initialized to 0 (indicating that there are initially no items in the buffer).
-    sem_init(&buffer -> articlesSemaphore, 0, 0);
+    initSemaphore(&buffer -> articlesSemaphore, 0, shared);
+    // No reader is listening for inserts until someone sets it (see createDispatcher).
+    buffer -> readySemaphore = NULL;
+    buffer -> readySet = NULL;
+    buffer -> readyIndex = 0;
+    buffer -> writerWakeup = NULL;
+    buffer -> writerWakeupArg = NULL;
+    atomic_init(&buffer -> tail, 0);
+    atomic_init(&buffer -> head, 0);
+    buffer -> cachedHead = 0;
+    buffer -> cachedTail = 0;
+    atomic_init(&buffer -> writerWaiting, 0);
+    atomic_init(&buffer -> readerWaiting, 0);
+    atomic_init(&buffer -> readyMarked, 0);
+    atomic_init(&buffer -> freedEpoch, 0);
+    STATS_QUEUE_INIT(buffer);
+}
+
+// Constructor of Bounded Buffer.
+BoundedBuffer* constructorBoundedBuffer(int size) {
+    return createBoundedBuffer(size, BUFFER_LOCKED);
+}
+
+// Constructor of a Bounded Buffer with exactly one writer thread and one reader thread.
+BoundedBuffer* constructorSpscBoundedBuffer(int size) {
+    return createBoundedBuffer(size, BUFFER_SPSC);
+}
+
+// Constructor of an SPSC Bounded Buffer in shared memory, for a writer and a reader in different processes.
+BoundedBuffer* constructorSharedSpscBoundedBuffer(int size, SharedArena* arena) {
+    BoundedBuffer* buffer = allocateSharedArena(arena, sizeof(BoundedBuffer));
+    Article** slots = allocateSharedArena(arena, boundedBufferCapacity(size, BUFFER_SPSC) * sizeof(Article*));
+    if (buffer == NULL || slots == NULL) {
+        fprintf(stderr, "The shared memory segment is full\n");
+        return NULL;
+    }
+    initBoundedBuffer(buffer, slots, NULL, size, BUFFER_SPSC, 1);
     return buffer;
 }
 
+// The bytes constructorSpscBoundedBufferIn needs for a buffer of 'size' articles (whole cache lines).
+size_t boundedBufferBytes(int size) {
+    return cacheAlignedSize(sizeof(BoundedBuffer)) + cacheAlignedSize(boundedBufferCapacity(size, BUFFER_SPSC) *
+                                                                      sizeof(Article*));
+}
+
+// Constructor of an SPSC Bounded Buffer in 'memory' (cache aligned, boundedBufferBytes(size) bytes) that the caller
+// owns: the destructor leaves it alone, the caller frees it.
+BoundedBuffer* constructorSpscBoundedBufferIn(void* memory, int size) {
+    BoundedBuffer* buffer = memory;
+    Article** slots = (Article**)((char*)memory + cacheAlignedSize(sizeof(BoundedBuffer)));
+    initBoundedBuffer(buffer, slots, NULL, size, BUFFER_SPSC, 0);
+    buffer -> borrowed = 1;
+    return buffer;
+}
+
+// Constructor of a Bounded Buffer with many writer threads and exactly one reader thread.
+BoundedBuffer* constructorMpscBoundedBuffer(int size) {
+    return createBoundedBuffer(size, BUFFER_MPSC);
+}
+
+/*
+ * SPSC ring.
+ * The writer only moves 'tail' and the reader only moves 'head', both only grow, so the ring holds (tail - head)
+ * articles (at most 'size'). They wrap around at 2^32, which is why the ring has a power of two slots
+ * (position & mask): with any other length the slot of position 0 would not follow the one of 2^32 - 1. An article is published by the release store of 'tail'
+ * (and a slot is given back by the release store of 'head'), no lock is needed.
+ * A side only touches a semaphore when the ring is really full (writer) or empty (reader).
+ * The MPSC reader sleeps and is woken the same way (see canContinueMpscBuffer).
+ */
+
+int canContinueMpscBuffer(BoundedBuffer* buffer, int writer);
+
+// Returns 1 if the writer has a free slot (writer = 1) or the reader has an article (writer = 0).
+int canContinueSpscBuffer(BoundedBuffer* buffer, int writer) {
+    if (buffer -> kind == BUFFER_MPSC) {
+        return canContinueMpscBuffer(buffer, writer);
+    }
+    unsigned int tail = atomic_load_explicit(&buffer -> tail, memory_order_acquire);
+    unsigned int head = atomic_load_explicit(&buffer -> head, memory_order_acquire);
+    return writer ? (tail - head < (unsigned int)buffer -> size) : (tail != head);
+}
+
+// WAIT_ADAPTIVE: watch the other side's index for a while before going to sleep. Returns 1 if it moved.
+int spinSpscBuffer(BoundedBuffer* buffer, int writer) {
+    int spins = waitSpinIterations();
+    for (int i = 0; i < spins; ++i) {
+        cpuRelax();
+        if (canContinueSpscBuffer(buffer, writer)) {
+            return 1;
+        }
+    }
+    for (int i = 0; i < WAIT_YIELD_ITERATIONS; ++i) {
+        sched_yield();
+        if (canContinueSpscBuffer(buffer, writer)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Sleep until the other side wakes us. 'waiting' tells the other side that it has to post 'semaphore'.
+// The caller checks its condition again after we return (we may also return without sleeping).
+// Returns 0 only if 'deadlineNs' passed before we were woken.
+int sleepSpscBuffer(BoundedBuffer* buffer, atomic_int* waiting, BatchSemaphore* semaphore, int writer, long long deadlineNs) {
+    if (buffer -> waitStrategy == WAIT_ADAPTIVE && spinSpscBuffer(buffer, writer)) {
+        return 1; // The other side moved while we were spinning, no need to raise the flag
+    }
+    atomic_store(waiting, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    // Check again after raising the flag, the other side may have moved just before it saw the flag.
+    if (canContinueSpscBuffer(buffer, writer)) {
+        // Take the flag back. If it is already gone the other side is posting, so take that post too.
+        if (atomic_exchange(waiting, 0) == 0) {
+            waitSemaphoreWith(semaphore, 0, buffer -> waitStrategy);
+        }
+        return 1;
+    }
+    if (!waitSemaphoreWith(semaphore, deadlineNs, buffer -> waitStrategy)) {
+        // Timed out, take the flag back the same way.
+        if (atomic_exchange(waiting, 0) == 0) {
+            waitSemaphoreWith(semaphore, 0, buffer -> waitStrategy);
+        }
+        return 0;
+    }
+    return 1;
+}
+
+// Wake the other side if it is sleeping (called after moving our index).
+void wakeSpscBuffer(atomic_int* waiting, BatchSemaphore* semaphore) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(waiting, memory_order_relaxed) && atomic_exchange(waiting, 0)) {
+        postSemaphore(semaphore, 1);
+    }
+}
+
+// Wake the writer if it is sleeping (called by the reader after it gave slots back).
+// If the writer is a task (see ProducerScheduler.c) it is scheduled again instead.
+void wakeSpscWriter(BoundedBuffer* buffer) {
+    if (buffer -> writerWakeup == NULL) {
+        wakeSpscBuffer(&buffer -> writerWaiting, &buffer -> slotsSemaphore);
+        return;
+    }
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&buffer -> writerWaiting, memory_order_relaxed) && atomic_exchange(&buffer -> writerWaiting, 0)) {
+        buffer -> writerWakeup(buffer -> writerWakeupArg);
+    }
+}
+
+// Mark the buffer in its reader's ready set, unless it is marked already (called after publishing).
+// wakeSpscBuffer's fence comes before: either we see the reader cleared the mark, or it sees our articles.
+void notifyReadyBuffer(BoundedBuffer* buffer, ReadySet* readySet) {
+    if (atomic_load_explicit(&buffer -> readyMarked, memory_order_relaxed) == 0 &&
+        atomic_exchange(&buffer -> readyMarked, 1) == 0) {
+        markReadySet(readySet, buffer -> readyIndex);
+    }
+}
+
+// Called by the reader that took the buffer from its ready set, before it removes from it.
+// Any insert after this marks the buffer again, and the ones before it are in the refreshed 'cachedTail'
+// (a stale copy would hide them from the next remove, with no mark left to bring us back).
+void clearReadyBuffer(BoundedBuffer* buffer) {
+    atomic_store_explicit(&buffer -> readyMarked, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    buffer -> cachedTail = atomic_load_explicit(&buffer -> tail, memory_order_acquire);
+}
+
+// Insert as many of the 'count' articles as fit, with a single publish of 'tail'. Returns how many (0 if full).
+int putSpscBuffer(BoundedBuffer* buffer, Article** articles, int count) {
+    unsigned int size = buffer -> size;
+    unsigned int tail = atomic_load_explicit(&buffer -> tail, memory_order_relaxed);
+    // Only read the reader's index when our cached copy says the ring is full.
+    if (tail - buffer -> cachedHead == size) {
+        buffer -> cachedHead = atomic_load_explicit(&buffer -> head, memory_order_acquire);
+        if (tail - buffer -> cachedHead == size) {
+            return 0;
+        }
+    }
+    ReadySet* readySet = buffer -> readySet;
+    int n = (int)(size - (tail - buffer -> cachedHead));
+    if (n > count) {
+        n = count;
+    }
+    for (int i = 0; i < n; ++i) {
+        buffer -> buffer[(tail + i) & buffer -> mask] = articles[i]; // Insert articles
+    }
+    atomic_store_explicit(&buffer -> tail, tail + n, memory_order_release); // Publish them
+    wakeSpscBuffer(&buffer -> readerWaiting, &buffer -> articlesSemaphore);
+    if (readySet != NULL) {
+        notifyReadyBuffer(buffer, readySet); // Wake up the reader if it doesn't know about us yet
+    }
+    return n;
+}
+
+// Insert 'count' articles, as many as fit at a time with a single publish of 'tail'.
+void insertSpscBufferBatch(BoundedBuffer* buffer, Article** articles, int count) {
+    int inserted = 0;
+    while (inserted < count) {
+        int n = putSpscBuffer(buffer, articles + inserted, count - inserted);
+        if (n == 0) {
+            sleepSpscBuffer(buffer, &buffer -> writerWaiting, &buffer -> slotsSemaphore, 1, 0);
+        }
+        inserted += n;
+    }
+}
+
+/*
+ * For a writer that must not block its thread (a producer task): raise the writer's flag so the reader
+ * calls 'writerWakeup' once it frees a slot. SPSC only.
+ * Returns 1 if the ring is still full (the writer can stop, it will be woken), 0 if a slot is free already.
+ */
+int armBoundedBufferWriter(BoundedBuffer* buffer) {
+    atomic_store(&buffer -> writerWaiting, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    // Check again after raising the flag, the reader may have moved just before it saw the flag.
+    if (canContinueSpscBuffer(buffer, 1)) {
+        // Take the flag back (if it is already gone the reader calls writerWakeup, which is harmless).
+        atomic_exchange(&buffer -> writerWaiting, 0);
+        return 0;
+    }
+    return 1;
+}
+
+void insertSpscBuffer(BoundedBuffer* buffer, Article* article) {
+    insertSpscBufferBatch(buffer, &article, 1);
+}
+
+// Remove up to 'max' articles from the ring with a single store of 'head'.
+// If it is empty: sleep when 'block' is set (until 'deadlineNs' if it is not 0), otherwise return 0.
+// Also returns 0 if the deadline passed.
+int removeSpscBufferBatch(BoundedBuffer* buffer, Article** articles, int max, int block, long long deadlineNs) {
+    unsigned int head = atomic_load_explicit(&buffer -> head, memory_order_relaxed);
+    while (head == buffer -> cachedTail) {
+        buffer -> cachedTail = atomic_load_explicit(&buffer -> tail, memory_order_acquire);
+        if (head == buffer -> cachedTail) {
+            if (!block) {
+                return 0;
+            }
+            if (!sleepSpscBuffer(buffer, &buffer -> readerWaiting, &buffer -> articlesSemaphore, 0, deadlineNs)) {
+                return 0;
+            }
+        }
+    }
+    int count = (int)(buffer -> cachedTail - head);
+    STATS_QUEUE_REMOVED(buffer, count < max ? count : max, count, buffer -> size);
+    if (count > max) {
+        count = max;
+    }
+    for (int i = 0; i < count; ++i) {
+        unsigned int slot = (head + i) & buffer -> mask;
+        articles[i] = buffer -> buffer[slot];
+        buffer -> buffer[slot] = NULL; // Clear the slot
+    }
+    atomic_store_explicit(&buffer -> head, head + count, memory_order_release); // Give the slots back
+    wakeSpscWriter(buffer);
+    return count;
+}
+
+// Remove an article from the ring (see removeSpscBufferBatch). Returns NULL when removeSpscBufferBatch returns 0.
+Article* removeSpscBuffer(BoundedBuffer* buffer, int block, long long deadlineNs) {
+    Article* article;
+    return removeSpscBufferBatch(buffer, &article, 1, block, deadlineNs) == 1 ? article : NULL;
+}
+
+/*
+ * MPSC slots (Vyukov style queue).
+ * Each writer claims its own consecutive positions with a compare-and-swap on 'tail', there is no lock
+ * and no counting semaphore. A slot's sequence number says what it is ready for:
+ * it is '2 * position' while the slot is free for the writer of that position, '2 * position + 1' once the
+ * article is in, and '2 * (position + mask + 1)' once the reader took it (free for the writer one lap later).
+ * (Doubled so a buffer of one slot can't mistake "written for this lap" for "free for the next one".)
+ * Positions and sequences wrap around at 2^32 like the SPSC ones, the power of two slots keep the laps in step.
+ * So a writer sees by itself that the buffer is full (the next slot was not taken yet in the last lap),
+ * and the reader sees that there is nothing to take (the slot at 'head' was not written yet).
+ * Only then does a side sleep: the reader like the SPSC reader, the writers on the freedEpoch futex.
+ */
+
+// Returns 1 if a writer can claim the slot at 'tail' (writer = 1) or the reader has the article at 'head' (writer = 0).
+int canContinueMpscBuffer(BoundedBuffer* buffer, int writer) {
+    if (writer) {
+        unsigned int tail = atomic_load_explicit(&buffer -> tail, memory_order_relaxed);
+        unsigned int sequence = atomic_load_explicit(&buffer -> sequences[tail & buffer -> mask], memory_order_acquire);
+        return (int)(sequence - 2 * tail) >= 0; // Free, or already claimed by another writer ('tail' moved)
+    }
+    unsigned int head = atomic_load_explicit(&buffer -> head, memory_order_relaxed);
+    return atomic_load_explicit(&buffer -> sequences[head & buffer -> mask], memory_order_acquire) == 2 * head + 1;
+}
+
+// Claim up to 'count' consecutive free positions. Returns how many (0 if the buffer is full), the first in '*position'.
+int claimMpscBuffer(BoundedBuffer* buffer, int count, unsigned int* position) {
+    unsigned int mask = buffer -> mask;
+    unsigned int tail = atomic_load_explicit(&buffer -> tail, memory_order_relaxed);
+    while (1) {
+        // The reader frees the slots in order, so the free ones after 'tail' are consecutive.
+        int n = 0;
+        while (n < count &&
+               atomic_load_explicit(&buffer -> sequences[(tail + n) & mask], memory_order_acquire) == 2 * (tail + n)) {
+            n++;
+        }
+        if (n == 0) {
+            unsigned int sequence = atomic_load_explicit(&buffer -> sequences[tail & mask], memory_order_acquire);
+            if ((int)(sequence - 2 * tail) < 0) {
+                return 0; // Still holds the article of the last lap
+            }
+            tail = atomic_load_explicit(&buffer -> tail, memory_order_relaxed); // Another writer claimed it
+            continue;
+        }
+        // On failure 'tail' is reloaded and we look again
+        if (atomic_compare_exchange_weak_explicit(&buffer -> tail, &tail, tail + n, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            *position = tail;
+            return n;
+        }
+    }
+}
+
+// Write 'count' articles to the positions claimed from 'position', and wake the reader if it sleeps.
+void fillMpscBuffer(BoundedBuffer* buffer, Article** articles, int count, unsigned int position) {
+    BatchSemaphore* readySemaphore = buffer -> readySemaphore;
+    for (int i = 0; i < count; ++i) {
+        unsigned int slot = (position + i) & buffer -> mask;
+        buffer -> buffer[slot] = articles[i]; // Insert article
+        atomic_store_explicit(&buffer -> sequences[slot], 2 * (position + i) + 1, memory_order_release); // Publish it
+    }
+    wakeSpscBuffer(&buffer -> readerWaiting, &buffer -> articlesSemaphore);
+    if (readySemaphore != NULL) {
+        postSemaphore(readySemaphore, count);
+    }
+}
+
+// Sleep until the reader frees a slot (returns at once if one is free already).
+void sleepMpscWriter(BoundedBuffer* buffer) {
+    if (buffer -> waitStrategy == WAIT_ADAPTIVE && spinSpscBuffer(buffer, 1)) {
+        return;
+    }
+    unsigned int epoch = atomic_load(&buffer -> freedEpoch);
+    atomic_fetch_add(&buffer -> writerWaiting, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    // Check again after counting ourselves, the reader may have freed a slot just before it saw us.
+    if (!canContinueMpscBuffer(buffer, 1)) {
+        futexWait(&buffer -> freedEpoch, epoch, 0, buffer -> shared);
+    }
+    atomic_fetch_sub(&buffer -> writerWaiting, 1);
+}
+
+// Wake the writers that sleep on a full buffer (called by the reader after it freed slots).
+void wakeMpscWriters(BoundedBuffer* buffer) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&buffer -> writerWaiting, memory_order_relaxed) > 0) {
+        atomic_fetch_add(&buffer -> freedEpoch, 1);
+        futexWake(&buffer -> freedEpoch, INT_MAX, buffer -> shared);
+    }
+}
+
+// Insert 'count' articles. Every round claims as many consecutive positions as there are free slots.
+void insertMpscBufferBatch(BoundedBuffer* buffer, Article** articles, int count) {
+    int inserted = 0;
+    while (inserted < count) {
+        unsigned int position;
+        int n = claimMpscBuffer(buffer, count - inserted, &position);
+        if (n == 0) {
+            sleepMpscWriter(buffer); // Full
+            continue;
+        }
+        fillMpscBuffer(buffer, articles + inserted, n, position);
+        inserted += n;
+    }
+}
+
+void insertMpscBuffer(BoundedBuffer* buffer, Article* article) {
+    insertMpscBufferBatch(buffer, &article, 1);
+}
+
+// Take up to 'max' articles that are written, in order from 'head'. Returns how many (0 if the next one is not).
+int takeMpscBuffer(BoundedBuffer* buffer, Article** articles, int max) {
+    unsigned int head = atomic_load_explicit(&buffer -> head, memory_order_relaxed);
+    int count = 0;
+    while (count < max) {
+        unsigned int position = head + count;
+        unsigned int slot = position & buffer -> mask;
+        if (atomic_load_explicit(&buffer -> sequences[slot], memory_order_acquire) != 2 * position + 1) {
+            break; // Not written yet (or a writer is still writing it)
+        }
+        articles[count++] = buffer -> buffer[slot];
+        buffer -> buffer[slot] = NULL; // Clear the slot
+        // The slot is free for the writer that claims it one lap later.
+        atomic_store_explicit(&buffer -> sequences[slot], 2 * (position + buffer -> mask + 1), memory_order_release);
+    }
+    if (count > 0) {
+        STATS_QUEUE_REMOVED(buffer, count, atomic_load_explicit(&buffer -> tail, memory_order_relaxed) - head,
+                            buffer -> mask + 1);
+        atomic_store_explicit(&buffer -> head, head + count, memory_order_release);
+        wakeMpscWriters(buffer);
+    }
+    return count;
+}
+
+// Remove up to 'max' articles. If there is none: sleep when 'block' is set (until 'deadlineNs' if it is not 0),
+// otherwise return 0. Also returns 0 if the deadline passed.
+int removeMpscBufferBatch(BoundedBuffer* buffer, Article** articles, int max, int block, long long deadlineNs) {
+    int count;
+    while ((count = takeMpscBuffer(buffer, articles, max)) == 0) {
+        if (!block || !sleepSpscBuffer(buffer, &buffer -> readerWaiting, &buffer -> articlesSemaphore, 0, deadlineNs)) {
+            return 0;
+        }
+    }
+    return count;
+}
+
+// Allocate a new segment for an Unbounded Buffer.
+UnboundedSegment* constructorUnboundedSegment() {
+    UnboundedSegment* segment = malloc(sizeof(UnboundedSegment));
+    if (segment == NULL) {
+        perror("Failed to allocate memory for Unbounded Buffer segment");
+        exit(-1);
+    }
+    segment -> next = NULL;
+    return segment;
+}
+
 // Constructor for Unbounded Buffer
 UnboundedBuffer* constructorUnboundedBuffer() {
+    return constructorLimitedUnboundedBuffer(0);
+}
+
+// Constructor of an Unbounded Buffer that holds at most 'limit' articles (0 = no limit).
+// The memory still grows a segment at a time, but the writers block once 'limit' articles are waiting.
+UnboundedBuffer* constructorLimitedUnboundedBuffer(int limit) {
     // Allocate memory for a UnboundedBuffer struct and store a pointer it.
     UnboundedBuffer* buffer = malloc(sizeof(UnboundedBuffer));
     if (buffer == NULL) {
         perror("Failed to allocate memory for UnboundedBuffer");
         return NULL;
     }
-    // Define the size of the buffer array within the BoundedBuffer structure (buffer is an array of char pointers)
-    buffer -> buffer = malloc(1 * sizeof(char*)); // Start with a size of 1
-    buffer -> buffer[0] = NULL;
-    buffer -> size = 1;
+    // Start with a single (empty) segment, more are linked as needed.
+    buffer -> head = constructorUnboundedSegment();
+    buffer -> tail = buffer -> head;
     buffer -> in = 0;
     buffer -> out = 0;
+    buffer -> freeSegments = NULL;
+    buffer -> numFreeSegments = 0;
+    buffer -> waitStrategy = WAIT_BLOCKING;
+    buffer -> limit = limit > 0 ? limit : 0;
     // 'pshared' is set to 0, the semaphore is shared between threads of the same process.
     // 'value' is set to 1 = mutex lock ->  Only one thread can "own" this lock at a time.
     // When value is 1 indicates that the lock is available,
     // while a value of 0 would indicate that the lock is not available
     sem_init(&buffer -> mutexSemaphore, 0, 1);
+    // initialized to the limit (all slots are free). Not used without a limit.
+    initSemaphore(&buffer -> slotsSemaphore, buffer -> limit, 0);
     // initialized to 0 (indicating that there are initially no items in the buffer).
-    sem_init(&buffer -> articlesSemaphore, 0, 0);
+    initSemaphore(&buffer -> articlesSemaphore, 0, 0);
+    STATS_QUEUE_INIT(buffer);
     return buffer;
 }
 
 /*
  * If the buffer is full, the insert function will block until a slot becomes free.
  */
-void insertBoundedBuffer(BoundedBuffer* buffer, char* article) {
+void insertBoundedBuffer(BoundedBuffer* buffer, Article* article) {
+    STATS_ENQUEUED(1);
+    if (buffer -> kind == BUFFER_SPSC) {
+        insertSpscBuffer(buffer, article);
+        return;
+    }
+    if (buffer -> kind == BUFFER_MPSC) {
+        insertMpscBuffer(buffer, article);
+        return;
+    }
+    BatchSemaphore* readySemaphore = buffer -> readySemaphore;
     // If slotsSemaphore value is more then zero it means there are free slots and we can continue. This line will decremnt the free slots,
-    // Otherwise, if slotsSemaphore value is zero sem_wait will  block the calling thread. (the thread will be stuck in this line).
-    sem_wait(&buffer -> slotsSemaphore); // Decrement free slots
+    // Otherwise, if slotsSemaphore value is zero it will block the calling thread. (the thread will be stuck in this line).
+    waitSemaphoreWith(&buffer -> slotsSemaphore, 0, buffer -> waitStrategy); // Decrement free slots
     // Acquiring the mutex lock to enter the critical section
     sem_wait(&buffer -> mutexSemaphore); // Enter critical section
     buffer -> buffer[buffer -> in] = article; // Insert article
     buffer -> in = (buffer -> in + 1) % buffer -> size; // Updates the in index to point to the next free slot in the buffer.
     sem_post(&buffer -> mutexSemaphore); // Exit critical section and releasing the mutex lock.
-    sem_post(&buffer -> articlesSemaphore); // Increment items
+    postSemaphore(&buffer -> articlesSemaphore, 1); // Increment items
+    if (readySemaphore != NULL) {
+        postSemaphore(readySemaphore, 1); // Wake up the reader (one post per article)
+    }
+}
+
+// Write 'count' articles in one critical section. The caller already took 'count' slotsSemaphore.
+void fillLockedBuffer(BoundedBuffer* buffer, Article** articles, int count) {
+    BatchSemaphore* readySemaphore = buffer -> readySemaphore;
+    sem_wait(&buffer -> mutexSemaphore); // Enter critical section
+    for (int i = 0; i < count; ++i) {
+        buffer -> buffer[buffer -> in] = articles[i]; // Insert article
+        buffer -> in = (buffer -> in + 1) % buffer -> size;
+    }
+    sem_post(&buffer -> mutexSemaphore); // Exit critical section
+    postSemaphore(&buffer -> articlesSemaphore, count); // Increment items
+    if (readySemaphore != NULL) {
+        postSemaphore(readySemaphore, count);
+    }
 }
 
 /*
- * If the buffer is full, the insert function will double the space, so it will behave like infinity space.
- * We dont need to use 'slotsSemaphore' because there will be always space for Articles.
+ * Insert 'count' articles. If the buffer is full, the insert function will block until a slot becomes free.
+ * Every round takes all the free slots it can get (up to what is left to insert) and fills them in one critical section.
+ * The slots are taken with a single adjustment of slotsSemaphore (see waitSemaphoreBatch).
  */
-void insertUnboundedBuffer(UnboundedBuffer* buffer, char* article) {
-    sem_wait(&buffer -> mutexSemaphore); // Enter critical section
-    if (buffer -> in == buffer -> size) { // If buffer is full
-        // Resize the buffer (double the size)
-        buffer -> size *= 2;
-        char **temp = realloc(buffer -> buffer, buffer -> size * sizeof(char*));
-        if (temp == NULL) {
-            perror("Failed to reallocate memory for Unbounded Buffer");
-            // Handle error here - you might choose to return from the function or otherwise clean up
+void insertBoundedBufferBatch(BoundedBuffer* buffer, Article** articles, int count) {
+    STATS_ENQUEUED(count);
+    if (buffer -> kind == BUFFER_SPSC) {
+        insertSpscBufferBatch(buffer, articles, count);
+        return;
+    }
+    if (buffer -> kind == BUFFER_MPSC) {
+        insertMpscBufferBatch(buffer, articles, count);
+        return;
+    }
+    int inserted = 0;
+    while (inserted < count) {
+        // Decrement free slots
+        int n = waitSemaphoreBatch(&buffer -> slotsSemaphore, count - inserted, 0, buffer -> waitStrategy);
+        fillLockedBuffer(buffer, articles + inserted, n);
+        inserted += n;
+    }
+}
+
+/*
+ * Insert as many of the 'count' articles as there are free slots right now, without ever blocking.
+ * Returns how many were inserted (0 if the buffer is full).
+ */
+int tryInsertBoundedBufferBatch(BoundedBuffer* buffer, Article** articles, int count) {
+    int n;
+    if (buffer -> kind == BUFFER_SPSC) {
+        n = putSpscBuffer(buffer, articles, count);
+    } else if (buffer -> kind == BUFFER_MPSC) {
+        unsigned int position;
+        n = claimMpscBuffer(buffer, count, &position);
+        if (n > 0) {
+            fillMpscBuffer(buffer, articles, n, position);
+        }
+    } else {
+        n = tryWaitSemaphore(&buffer -> slotsSemaphore, count); // Decrement free slots
+        if (n > 0) {
+            fillLockedBuffer(buffer, articles, n);
+        }
+    }
+    STATS_ENQUEUED(n);
+    return n;
+}
+
+// Put an article at the end of an Unbounded Buffer. The caller holds mutexSemaphore.
+void putUnboundedBuffer(UnboundedBuffer* buffer, Article* article) {
+    if (buffer -> in == SEGMENT_SIZE) { // If the tail segment is full
+        UnboundedSegment* segment = buffer -> freeSegments;
+        if (segment != NULL) {
+            buffer -> freeSegments = segment -> next;
+            buffer -> numFreeSegments -= 1;
+            segment -> next = NULL;
         } else {
-            buffer -> buffer = temp;
+            segment = constructorUnboundedSegment();
         }
+        buffer -> tail -> next = segment;
+        buffer -> tail = segment;
+        buffer -> in = 0;
     }
 
-    buffer -> buffer[buffer -> in] = article; // Insert item
+    buffer -> tail -> buffer[buffer -> in] = article; // Insert item
     buffer -> in += 1; // Increment 'in' (move to the next cell)
-    sem_post(&buffer -> mutexSemaphore); // Exit critical section and releasing the mutex lock.
-    sem_post(&buffer -> articlesSemaphore); // Increment items
 }
 
 /*
- * If the buffer is empty, the remove function will NOT block until an item becomes available.
+ * If the tail segment is full, the insert function links a new segment, so it will behave like infinity space.
+ * The new segment is a recycled one when possible, so a long run doesn't keep allocating.
+ * Without a limit we dont need to use 'slotsSemaphore' because there will be always space for Articles.
  */
-char* removeBoundedBuffer(BoundedBuffer* buffer) {
-    sem_wait(&buffer -> articlesSemaphore); // Decrement the number of items
+void insertUnboundedBuffer(UnboundedBuffer* buffer, Article* article) {
+    insertUnboundedBufferBatch(buffer, &article, 1);
+}
+
+// Insert 'count' articles, in a single critical section when there is no limit (or enough free slots).
+// With a limit, every round blocks for one free slot and takes the others it can get without blocking.
+void insertUnboundedBufferBatch(UnboundedBuffer* buffer, Article** articles, int count) {
+    if (count == 0) {
+        return;
+    }
+    STATS_ENQUEUED(count);
+    int inserted = 0;
+    while (inserted < count) {
+        int n = count - inserted;
+        if (buffer -> limit > 0) {
+            n = waitSemaphoreBatch(&buffer -> slotsSemaphore, n, 0, buffer -> waitStrategy); // Decrement free slots
+        }
+        sem_wait(&buffer -> mutexSemaphore); // Enter critical section
+        for (int i = 0; i < n; ++i) {
+            putUnboundedBuffer(buffer, articles[inserted + i]);
+        }
+        sem_post(&buffer -> mutexSemaphore); // Exit critical section
+        postSemaphore(&buffer -> articlesSemaphore, n); // Increment items
+        inserted += n;
+    }
+}
+
+// Take 'count' articles from a locked buffer in one critical section. The caller already took 'count' articlesSemaphore.
+void takeLockedBuffer(BoundedBuffer* buffer, Article** articles, int count) {
     sem_wait(&buffer -> mutexSemaphore); // Enter critical section
-    char* article = buffer -> buffer[buffer->out];
-    buffer -> buffer[buffer -> out] = NULL; // Clear the slot
-    buffer -> out = (buffer -> out + 1) % buffer -> size; // Increment 'out'
+#ifdef INSTRUMENT
+    int waiting = atomic_load_explicit(&buffer -> articlesSemaphore.value, memory_order_relaxed);
+    STATS_QUEUE_REMOVED(buffer, count, count + waiting, buffer -> size);
+#endif
+    for (int i = 0; i < count; ++i) {
+        articles[i] = buffer -> buffer[buffer->out];
+        buffer -> buffer[buffer -> out] = NULL; // Clear the slot
+        buffer -> out = (buffer -> out + 1) % buffer -> size; // Increment 'out'
+    }
     sem_post(&buffer -> mutexSemaphore); // Exit critical section
-    sem_post(&buffer -> slotsSemaphore); // Increment the number of free slots
+    postSemaphore(&buffer -> slotsSemaphore, count); // Increment the number of free slots
+}
+
+/*
+ * Block until there is at least one article (or until 'deadlineNs', if it is not 0),
+ * then take up to 'max' articles without blocking again.
+ * Returns how many articles were written to 'articles' (0 if the deadline passed).
+ */
+int removeBoundedBufferBatchUntil(BoundedBuffer* buffer, Article** articles, int max, long long deadlineNs) {
+    if (buffer -> kind == BUFFER_SPSC) {
+        return removeSpscBufferBatch(buffer, articles, max, 1, deadlineNs);
+    }
+    if (buffer -> kind == BUFFER_MPSC) {
+        return removeMpscBufferBatch(buffer, articles, max, 1, deadlineNs);
+    }
+    int count = waitSemaphoreBatch(&buffer -> articlesSemaphore, max, deadlineNs, buffer -> waitStrategy); // Decrement items
+    if (count == 0) {
+        return 0;
+    }
+    takeLockedBuffer(buffer, articles, count);
+    return count;
+}
+
+/*
+ * Block until there is at least one article, then take up to 'max' articles without blocking again.
+ * Returns how many articles were written to 'articles'.
+ */
+int removeBoundedBufferBatch(BoundedBuffer* buffer, Article** articles, int max) {
+    return removeBoundedBufferBatchUntil(buffer, articles, max, 0);
+}
+
+/*
+ * Take up to 'max' articles without blocking. Returns how many articles were written to 'articles' (maybe 0).
+ */
+int tryRemoveBoundedBufferBatch(BoundedBuffer* buffer, Article** articles, int max) {
+    if (buffer -> kind == BUFFER_SPSC) {
+        return removeSpscBufferBatch(buffer, articles, max, 0, 0);
+    }
+    if (buffer -> kind == BUFFER_MPSC) {
+        return removeMpscBufferBatch(buffer, articles, max, 0, 0);
+    }
+    int count = tryWaitSemaphore(&buffer -> articlesSemaphore, max);
+    takeLockedBuffer(buffer, articles, count);
+    return count;
+}
+
+/*
+ * The article the next remove would return, without removing it. NULL if there is none (yet).
+ * Only for the reader of a SPSC or MPSC buffer (a locked buffer always returns NULL).
+ */
+Article* peekBoundedBuffer(BoundedBuffer* buffer) {
+    unsigned int head = atomic_load_explicit(&buffer -> head, memory_order_relaxed);
+    unsigned int slot = head & buffer -> mask;
+    if (buffer -> kind == BUFFER_SPSC) {
+        if (head == buffer -> cachedTail) {
+            buffer -> cachedTail = atomic_load_explicit(&buffer -> tail, memory_order_acquire);
+        }
+        return head != buffer -> cachedTail ? buffer -> buffer[slot] : NULL;
+    }
+    if (buffer -> kind == BUFFER_MPSC &&
+        atomic_load_explicit(&buffer -> sequences[slot], memory_order_acquire) == 2 * head + 1) {
+        return buffer -> buffer[slot];
+    }
+    return NULL;
+}
 
+/*
+ * If the buffer is empty, the remove function will block until an item becomes available,
+ * or until 'deadlineNs' (monotonic clock) if it is not 0. Returns NULL if the deadline passed.
+ */
+Article* removeBoundedBufferUntil(BoundedBuffer* buffer, long long deadlineNs) {
+    Article* article;
+    return removeBoundedBufferBatchUntil(buffer, &article, 1, deadlineNs) == 1 ? article : NULL;
+}
+
+/*
+ * If the buffer is empty, the remove function will block until an item becomes available.
+ */
+Article* removeBoundedBuffer(BoundedBuffer* buffer) {
+    return removeBoundedBufferUntil(buffer, 0);
+}
+
+/*
+ * Same as removeBoundedBuffer, but if the buffer is empty it returns NULL instead of blocking.
+ */
+Article* tryRemoveBoundedBuffer(BoundedBuffer* buffer) {
+    Article* article;
+    return tryRemoveBoundedBufferBatch(buffer, &article, 1) == 1 ? article : NULL;
+}
+
+// Take the article at 'out' of an Unbounded Buffer. The caller holds mutexSemaphore and took one articlesSemaphore.
+Article* takeUnboundedBuffer(UnboundedBuffer* buffer) {
+    Article* article = buffer -> head -> buffer[buffer -> out];
+    buffer -> head -> buffer[buffer -> out] = NULL; // Clear the slot
+    buffer -> out += 1; // Increment 'out'
+    if (buffer -> head == buffer -> tail && buffer -> out == buffer -> in) {
+        // The buffer is empty, start over at the beginning of the same segment.
+        buffer -> in = 0;
+        buffer -> out = 0;
+    } else if (buffer -> out == SEGMENT_SIZE) {
+        // We are done with the head segment, keep it for reuse (or free it if we already keep enough).
+        UnboundedSegment* segment = buffer -> head;
+        buffer -> head = segment -> next;
+        buffer -> out = 0;
+        if (buffer -> numFreeSegments < MAX_FREE_SEGMENTS) {
+            segment -> next = buffer -> freeSegments;
+            buffer -> freeSegments = segment;
+            buffer -> numFreeSegments += 1;
+        } else {
+            free(segment);
+        }
+    }
+    return article;
+}
+
+Article* removeUnboundedBuffer(UnboundedBuffer* buffer) {
+    Article* article;
+    removeUnboundedBufferBatch(buffer, &article, 1);
     return article;
 }
 
-char* removeUnboundedBuffer(UnboundedBuffer* buffer) {
-    sem_wait(&buffer -> articlesSemaphore); // Decrement the number of items
+/*
+ * Block until there is at least one article, then take up to 'max' articles in a single critical section.
+ * Returns how many articles were written to 'articles'.
+ */
+int removeUnboundedBufferBatch(UnboundedBuffer* buffer, Article** articles, int max) {
+    return removeUnboundedBufferBatchUntil(buffer, articles, max, 0);
+}
+
+/*
+ * Same as removeUnboundedBufferBatch, but gives up at 'deadlineNs' (monotonic clock) if it is not 0.
+ * Returns 0 if the deadline passed.
+ */
+int removeUnboundedBufferBatchUntil(UnboundedBuffer* buffer, Article** articles, int max, long long deadlineNs) {
+    int count = waitSemaphoreBatch(&buffer -> articlesSemaphore, max, deadlineNs, buffer -> waitStrategy); // Decrement items
+    if (count == 0) {
+        return 0;
+    }
     sem_wait(&buffer -> mutexSemaphore); // Enter critical section
-    char* article = buffer -> buffer[buffer -> out];
-    buffer->buffer[buffer -> out] = NULL; // Clear the slot
-    buffer -> out += 1; // Increment 'out'
+#ifdef INSTRUMENT
+    int waiting = atomic_load_explicit(&buffer -> articlesSemaphore.value, memory_order_relaxed);
+    STATS_QUEUE_REMOVED(buffer, count, count + waiting, buffer -> limit);
+#endif
+    for (int i = 0; i < count; ++i) {
+        articles[i] = takeUnboundedBuffer(buffer);
+    }
     sem_post(&buffer -> mutexSemaphore); // Exit critical section
-    return article;
+    if (buffer -> limit > 0) {
+        postSemaphore(&buffer -> slotsSemaphore, count); // Increment the number of free slots
+    }
+    return count;
 }
 
 // Destructor for BoundedBuffer
@@ -124,10 +988,12 @@ void destructorBoundedBuffer(BoundedBuffer* buffer) {
     }
     // Destroy semaphores
     sem_destroy(&buffer -> mutexSemaphore);
-    sem_destroy(&buffer -> slotsSemaphore);
-    sem_destroy(&buffer -> articlesSemaphore);
+    if (buffer -> borrowed) {
+        return; // Its memory belongs to the arena (or to the block it was created in)
+    }
     // Free the buffer array within the BoundedBuffer structure
     free(buffer -> buffer);
+    free(buffer -> sequences);
     // Free the BoundedBuffer structure itself
     free(buffer);
 }
@@ -139,9 +1005,16 @@ void destructorUnboundedBuffer(UnboundedBuffer* buffer) {
     }
     // Destroy semaphores
     sem_destroy(&buffer -> mutexSemaphore);
-    sem_destroy(&buffer -> articlesSemaphore);
-    // Free the buffer array within the UnboundedBuffer structure
-    free(buffer -> buffer);
+    // Free all the segments (the ones in use and the ones kept for reuse)
+    UnboundedSegment* lists[2] = {buffer -> head, buffer -> freeSegments};
+    for (int i = 0; i < 2; ++i) {
+        UnboundedSegment* segment = lists[i];
+        while (segment != NULL) {
+            UnboundedSegment* next = segment -> next;
+            free(segment);
+            segment = next;
+        }
+    }
     // Free the UnboundedBuffer structure itself
     free(buffer);
 }
\ No newline at end of file
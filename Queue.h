@@ -2,12 +2,50 @@
 #ifndef TASK3_QUEUE_H
 #define TASK3_QUEUE_H
 #include "Structs.h"
-void insertUnboundedBuffer(UnboundedBuffer* buffer, char* article);
-void insertBoundedBuffer(BoundedBuffer* buffer, char* article);
-char* removeBoundedBuffer(BoundedBuffer* buffer);
-char* removeUnboundedBuffer(UnboundedBuffer* buffer);
+
+// WAIT_ADAPTIVE: how many times to check with a pause in between, then how many times with a sched_yield.
+#define WAIT_SPIN_ITERATIONS 200
+#define WAIT_YIELD_ITERATIONS 8
+
+void futexWait(atomic_uint* word, unsigned int expected, long long deadlineNs, int shared);
+void futexWake(atomic_uint* word, int count, int shared);
+void initSemaphore(BatchSemaphore* semaphore, unsigned int value, int shared);
+int waitSemaphoreBatch(BatchSemaphore* semaphore, int max, long long deadlineNs, WaitStrategy strategy);
+int waitSemaphoreWith(BatchSemaphore* semaphore, long long deadlineNs, WaitStrategy strategy);
+int waitSemaphore(BatchSemaphore* semaphore, long long deadlineNs);
+int sleepSemaphore(BatchSemaphore* semaphore, int max, long long deadlineNs);
+int tryWaitSemaphore(BatchSemaphore* semaphore, int max);
+void postSemaphore(BatchSemaphore* semaphore, int count);
+void insertUnboundedBuffer(UnboundedBuffer* buffer, Article* article);
+void insertUnboundedBufferBatch(UnboundedBuffer* buffer, Article** articles, int count);
+void insertBoundedBuffer(BoundedBuffer* buffer, Article* article);
+void insertBoundedBufferBatch(BoundedBuffer* buffer, Article** articles, int count);
+int tryInsertBoundedBufferBatch(BoundedBuffer* buffer, Article** articles, int count);
+int armBoundedBufferWriter(BoundedBuffer* buffer);
+void notifyReadyBuffer(BoundedBuffer* buffer, ReadySet* readySet);
+void clearReadyBuffer(BoundedBuffer* buffer);
+Article* removeBoundedBuffer(BoundedBuffer* buffer);
+Article* removeBoundedBufferUntil(BoundedBuffer* buffer, long long deadlineNs);
+Article* tryRemoveBoundedBuffer(BoundedBuffer* buffer);
+int removeBoundedBufferBatch(BoundedBuffer* buffer, Article** articles, int max);
+int removeBoundedBufferBatchUntil(BoundedBuffer* buffer, Article** articles, int max, long long deadlineNs);
+int tryRemoveBoundedBufferBatch(BoundedBuffer* buffer, Article** articles, int max);
+Article* peekBoundedBuffer(BoundedBuffer* buffer);
+Article* removeUnboundedBuffer(UnboundedBuffer* buffer);
+int removeUnboundedBufferBatch(UnboundedBuffer* buffer, Article** articles, int max);
+int removeUnboundedBufferBatchUntil(UnboundedBuffer* buffer, Article** articles, int max, long long deadlineNs);
+void initBoundedBuffer(BoundedBuffer* buffer, Article** slots, atomic_uint* sequences, int size, BufferKind kind,
+                       int shared);
 BoundedBuffer* constructorBoundedBuffer(int size);
+BoundedBuffer* constructorSpscBoundedBuffer(int size);
+BoundedBuffer* constructorMpscBoundedBuffer(int size);
+BoundedBuffer* constructorSharedSpscBoundedBuffer(int size, SharedArena* arena);
+int boundedBufferCapacity(int size, BufferKind kind);
+size_t boundedBufferBytes(int size);
+BoundedBuffer* constructorSpscBoundedBufferIn(void* memory, int size);
+UnboundedSegment* constructorUnboundedSegment();
 UnboundedBuffer* constructorUnboundedBuffer();
+UnboundedBuffer* constructorLimitedUnboundedBuffer(int limit);
 void destructorBoundedBuffer(BoundedBuffer* buffer);
 void destructorUnboundedBuffer(UnboundedBuffer* buffer);
 #endif //TASK3_QUEUE_H
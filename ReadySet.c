@@ -0,0 +1,99 @@
+# include "ReadySet.h"
+#include <limits.h>
+
+/*
+ * The buffers a single thread reads (a dispatcher shard's producers, or a direct co-editor's lanes) that may
+ * have articles, so it only visits those instead of all of them on every wakeup.
+ * It is a two level bitmap: a bit per member, and a summary bit per word of member bits. A writer marks its
+ * buffer when it publishes into it and the buffer isn't marked already (see notifyReadyBuffer in Queue.c),
+ * and only the mark that sets a summary bit posts 'wake'. The reader clears the words it takes, so the cost
+ * of a wakeup depends on how many members have data, not on how many members there are.
+ */
+
+#define READY_WORD_BITS 64
+
+int readyWords(int numMembers) {
+    return (numMembers + READY_WORD_BITS - 1) / READY_WORD_BITS;
+}
+
+// The memory the bitmaps of a set of 'numMembers' take (in a SharedArena: one piece).
+size_t readySetBytes(int numMembers) {
+    int words = readyWords(numMembers);
+    return (words + readyWords(words)) * sizeof(atomic_ullong);
+}
+
+// Initialize an empty set. The bitmaps come from 'arena' (NULL = malloc), 'wake' is process-shared with an arena.
+// Returns 0, or -1 if there is no memory.
+int initReadySet(ReadySet* set, int numMembers, SharedArena* arena) {
+    int words = readyWords(numMembers);
+    size_t bytes = readySetBytes(numMembers);
+    set -> words = arena != NULL ? allocateSharedArena(arena, bytes) : malloc(bytes > 0 ? bytes : 1);
+    if (set -> words == NULL) {
+        perror("Failed to allocate memory for ReadySet");
+        return -1;
+    }
+    set -> summary = set -> words + words;
+    set -> numWords = words;
+    set -> numSummary = readyWords(words);
+    set -> arena = arena;
+    for (int i = 0; i < words + set -> numSummary; ++i) {
+        atomic_init(&set -> words[i], 0);
+    }
+    initSemaphore(&set -> wake, 0, arena != NULL);
+    return 0;
+}
+
+// Mark 'member' as having articles, and wake the reader if it may not look at its word otherwise.
+void markReadySet(ReadySet* set, int member) {
+    int word = member / READY_WORD_BITS;
+    unsigned long long bit = 1ULL << (member % READY_WORD_BITS);
+    if (atomic_fetch_or(&set -> words[word], bit) & bit) {
+        return; // Already marked, the reader didn't take it yet
+    }
+    unsigned long long wordBit = 1ULL << (word % READY_WORD_BITS);
+    if (atomic_fetch_or(&set -> summary[word / READY_WORD_BITS], wordBit) & wordBit) {
+        return; // The reader will take this word anyway
+    }
+    postSemaphore(&set -> wake, 1);
+}
+
+// Mark 'member' and wake the reader in any case. For a writer that may have stopped halfway through
+// markReadySet (a producer process that died): its bits may be set without the post that goes with them.
+void forceMarkReadySet(ReadySet* set, int member) {
+    int word = member / READY_WORD_BITS;
+    atomic_fetch_or(&set -> words[word], 1ULL << (member % READY_WORD_BITS));
+    atomic_fetch_or(&set -> summary[word / READY_WORD_BITS], 1ULL << (word % READY_WORD_BITS));
+    postSemaphore(&set -> wake, 1);
+}
+
+// Sleep until some member was marked. Takes every pending wakeup at once, returns how many there were.
+int waitReadySet(ReadySet* set, WaitStrategy strategy) {
+    return waitSemaphoreBatch(&set -> wake, INT_MAX, 0, strategy);
+}
+
+// Take (and clear) the marked members, in increasing order. 'members' has room for all of them.
+// Returns how many were written (0 if none is marked).
+int takeReadySet(ReadySet* set, int* members) {
+    int count = 0;
+    for (int s = 0; s < set -> numSummary; ++s) {
+        // Clear the summary first: a writer that marks after this posts 'wake' again.
+        unsigned long long words = atomic_exchange(&set -> summary[s], 0);
+        while (words != 0) {
+            int word = s * READY_WORD_BITS + __builtin_ctzll(words);
+            words &= words - 1;
+            unsigned long long bits = atomic_exchange(&set -> words[word], 0);
+            while (bits != 0) {
+                members[count++] = word * READY_WORD_BITS + __builtin_ctzll(bits);
+                bits &= bits - 1;
+            }
+        }
+    }
+    return count;
+}
+
+// Free the bitmaps (an arena frees them itself).
+void destroyReadySet(ReadySet* set) {
+    if (set -> arena == NULL) {
+        free(set -> words);
+    }
+}
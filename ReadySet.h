@@ -0,0 +1,12 @@
+#pragma once
+#ifndef TASK3_READYSET_H
+#define TASK3_READYSET_H
+#include "Structs.h"
+size_t readySetBytes(int numMembers);
+int initReadySet(ReadySet* set, int numMembers, SharedArena* arena);
+void markReadySet(ReadySet* set, int member);
+void forceMarkReadySet(ReadySet* set, int member);
+int waitReadySet(ReadySet* set, WaitStrategy strategy);
+int takeReadySet(ReadySet* set, int* members);
+void destroyReadySet(ReadySet* set);
+#endif //TASK3_READYSET_H
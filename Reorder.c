@@ -0,0 +1,195 @@
+# include "Reorder.h"
+
+/*
+ * With more than one co-editor per type ("CoEditors 4"), two articles of the same producer and type are edited
+ * at the same time and may reach the manager in the wrong order. "Reorder <window> [timeoutMs]" makes the manager
+ * write them in the order of their 'sequence' (set by the producer, per type): an article that comes before
+ * the ones it follows is held until they are written.
+ * It never waits forever: when 'window' articles are held, or the oldest one was held for 'timeoutMs', it stops
+ * waiting for what is missing before the oldest one. If a missing article comes after that, it is written at once
+ * (out of order) and counted as late.
+ * Every held article is in two lists: the one of its producer and type (by sequence, to find the next one in O(1))
+ * and the one of all held articles (by arrival, to find the oldest one in O(1)).
+ */
+
+// Constructor of a ReorderBuffer for producer ids 0..maxProducerId, that gives the articles to 'emit' in order.
+ReorderBuffer* constructorReorderBuffer(int window, int timeoutMs, int maxProducerId,
+                                        void (*emit)(void* arg, Article* article, long long now), void* emitArg) {
+    ReorderBuffer* buffer = malloc(sizeof(ReorderBuffer));
+    if (buffer == NULL) {
+        perror("Failed to allocate memory for ReorderBuffer");
+        return NULL;
+    }
+    buffer -> numKeys = (maxProducerId + 1) * numArticleTypes;
+    buffer -> nextSequence = calloc(buffer -> numKeys, sizeof(int));
+    buffer -> held = calloc(buffer -> numKeys, sizeof(ReorderNode*));
+    buffer -> nodes = malloc(window * sizeof(ReorderNode));
+    if (buffer -> nextSequence == NULL || buffer -> held == NULL || buffer -> nodes == NULL) {
+        perror("Failed to allocate memory for ReorderBuffer");
+        free(buffer -> nextSequence);
+        free(buffer -> held);
+        free(buffer -> nodes);
+        free(buffer);
+        return NULL;
+    }
+    // All the nodes start in the free list
+    for (int i = 0; i < window; ++i) {
+        buffer -> nodes[i].older = i + 1 < window ? &buffer -> nodes[i + 1] : NULL;
+    }
+    buffer -> freeNodes = &buffer -> nodes[0];
+    buffer -> oldest = NULL;
+    buffer -> newest = NULL;
+    buffer -> window = window;
+    buffer -> numHeld = 0;
+    buffer -> timeoutNs = timeoutMs * 1000000LL;
+    buffer -> emit = emit;
+    buffer -> emitArg = emitArg;
+    buffer -> reordered = 0;
+    buffer -> gaps = 0;
+    buffer -> late = 0;
+    buffer -> highWater = 0;
+    return buffer;
+}
+
+// Write the held articles of 'key' that are next in its order.
+void drainReorderKey(ReorderBuffer* buffer, int key, long long now) {
+    ReorderNode* node;
+    while ((node = buffer -> held[key]) != NULL && node -> article -> sequence == buffer -> nextSequence[key]) {
+        buffer -> held[key] = node -> nextInKey;
+        // Out of the arrival list, into the free list
+        if (node -> older != NULL) {
+            node -> older -> newer = node -> newer;
+        } else {
+            buffer -> oldest = node -> newer;
+        }
+        if (node -> newer != NULL) {
+            node -> newer -> older = node -> older;
+        } else {
+            buffer -> newest = node -> older;
+        }
+        buffer -> numHeld--;
+        buffer -> nextSequence[key]++;
+        buffer -> emit(buffer -> emitArg, node -> article, now);
+        node -> older = buffer -> freeNodes;
+        buffer -> freeNodes = node;
+    }
+}
+
+// Stop waiting for the articles missing before the oldest held one, and write it (and whatever follows it).
+void giveUpOldestReorder(ReorderBuffer* buffer, long long now) {
+    ReorderNode* oldest = buffer -> oldest;
+    int key = oldest -> article -> producerId * numArticleTypes + oldest -> article -> type;
+    // Its key may hold lower sequences that came later, they go first.
+    while (buffer -> oldest == oldest) {
+        buffer -> gaps++;
+        buffer -> nextSequence[key] = buffer -> held[key] -> article -> sequence;
+        drainReorderKey(buffer, key, now);
+    }
+}
+
+// Hold 'article' until the articles before it are written.
+void holdReorderArticle(ReorderBuffer* buffer, int key, Article* article, long long now) {
+    if (buffer -> freeNodes == NULL) {
+        giveUpOldestReorder(buffer, now); // The window is full
+        if (article -> sequence == buffer -> nextSequence[key]) {
+            // It was waiting for this one
+            buffer -> nextSequence[key]++;
+            buffer -> emit(buffer -> emitArg, article, now);
+            drainReorderKey(buffer, key, now);
+            return;
+        }
+        if (article -> sequence < buffer -> nextSequence[key]) {
+            buffer -> late++;
+            buffer -> emit(buffer -> emitArg, article, now);
+            return;
+        }
+    }
+    ReorderNode* node = buffer -> freeNodes;
+    buffer -> freeNodes = node -> older;
+    node -> article = article;
+    node -> arrivedNs = now;
+    // Into its key's list, by sequence
+    ReorderNode** place = &buffer -> held[key];
+    while (*place != NULL && (*place) -> article -> sequence < article -> sequence) {
+        place = &(*place) -> nextInKey;
+    }
+    node -> nextInKey = *place;
+    *place = node;
+    // At the end of the arrival list
+    node -> older = buffer -> newest;
+    node -> newer = NULL;
+    if (buffer -> newest != NULL) {
+        buffer -> newest -> newer = node;
+    } else {
+        buffer -> oldest = node;
+    }
+    buffer -> newest = node;
+    buffer -> numHeld++;
+    buffer -> reordered++;
+    if (buffer -> numHeld > buffer -> highWater) {
+        buffer -> highWater = buffer -> numHeld;
+    }
+}
+
+// An article came to the manager at 'now': write it if it is next in its order (and the held ones after it), else hold it.
+void reorderArticle(ReorderBuffer* buffer, Article* article, long long now) {
+    int key = article -> producerId * numArticleTypes + article -> type;
+    if (key < 0 || key >= buffer -> numKeys) {
+        buffer -> emit(buffer -> emitArg, article, now); // Not a producer we know, nothing to order it with
+        return;
+    }
+    if (article -> sequence == buffer -> nextSequence[key]) {
+        buffer -> nextSequence[key]++;
+        buffer -> emit(buffer -> emitArg, article, now);
+        drainReorderKey(buffer, key, now);
+    } else if (article -> sequence < buffer -> nextSequence[key]) {
+        buffer -> late++; // We already stopped waiting for it
+        buffer -> emit(buffer -> emitArg, article, now);
+    } else {
+        holdReorderArticle(buffer, key, article, now);
+    }
+}
+
+// Returns 1 if some articles are held.
+int hasHeldArticles(ReorderBuffer* buffer) {
+    return buffer -> oldest != NULL;
+}
+
+// The time (monotonic clock, nanoseconds) at which the oldest held article stops waiting.
+long long reorderDeadline(ReorderBuffer* buffer) {
+    return buffer -> oldest -> arrivedNs + buffer -> timeoutNs;
+}
+
+// Stop waiting for the articles before the ones held for longer than the timeout.
+void releaseTimedOutArticles(ReorderBuffer* buffer, long long now) {
+    while (hasHeldArticles(buffer) && reorderDeadline(buffer) <= now) {
+        giveUpOldestReorder(buffer, now);
+    }
+}
+
+// Write everything that is held (nothing more is coming).
+void flushReorderBuffer(ReorderBuffer* buffer, long long now) {
+    while (hasHeldArticles(buffer)) {
+        giveUpOldestReorder(buffer, now);
+    }
+}
+
+// Print how much reordering there was.
+void printReorderBuffer(ReorderBuffer* buffer, FILE* file) {
+    fprintf(file, "Reorder (window %d, timeout %lld ms): %lld articles held, at most %d at once, "
+                  "%lld gaps given up, %lld articles late\n",
+            buffer -> window, buffer -> timeoutNs / 1000000, buffer -> reordered, buffer -> highWater,
+            buffer -> gaps, buffer -> late);
+    fflush(file);
+}
+
+// Destructor for ReorderBuffer.
+void destructorReorderBuffer(ReorderBuffer* buffer) {
+    if (buffer == NULL) {
+        return;
+    }
+    free(buffer -> nextSequence);
+    free(buffer -> held);
+    free(buffer -> nodes);
+    free(buffer);
+}
@@ -0,0 +1,17 @@
+#pragma once
+#ifndef TASK3_REORDER_H
+#define TASK3_REORDER_H
+#include "Structs.h"
+ReorderBuffer* constructorReorderBuffer(int window, int timeoutMs, int maxProducerId,
+                                        void (*emit)(void* arg, Article* article, long long now), void* emitArg);
+void drainReorderKey(ReorderBuffer* buffer, int key, long long now);
+void giveUpOldestReorder(ReorderBuffer* buffer, long long now);
+void holdReorderArticle(ReorderBuffer* buffer, int key, Article* article, long long now);
+void reorderArticle(ReorderBuffer* buffer, Article* article, long long now);
+int hasHeldArticles(ReorderBuffer* buffer);
+long long reorderDeadline(ReorderBuffer* buffer);
+void releaseTimedOutArticles(ReorderBuffer* buffer, long long now);
+void flushReorderBuffer(ReorderBuffer* buffer, long long now);
+void printReorderBuffer(ReorderBuffer* buffer, FILE* file);
+void destructorReorderBuffer(ReorderBuffer* buffer);
+#endif //TASK3_REORDER_H
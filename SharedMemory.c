@@ -0,0 +1,72 @@
+# include "SharedMemory.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+
+/*
+ * A named shared memory segment for the producer processes: their buffers, their articles and the semaphores
+ * the dispatcher shares with them. It is created (and mapped) before the processes are forked, so every pointer
+ * into it is valid in all of them and an article moves between processes without being copied.
+ * The pages are only backed by memory once they are touched, so the size may be a generous upper bound.
+ * Memory is never given back piece by piece, all of it goes away with destructorSharedArena.
+ */
+
+// Constructor of a Shared Arena of 'size' bytes (shm_open + mmap). Returns NULL on error.
+SharedArena* constructorSharedArena(size_t size) {
+    SharedArena* arena = malloc(sizeof(SharedArena));
+    if (arena == NULL) {
+        perror("Failed to allocate memory for SharedArena");
+        return NULL;
+    }
+    snprintf(arena -> name, sizeof(arena -> name), "/task3-%d", (int)getpid());
+    int fd = shm_open(arena -> name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1) {
+        perror("Failed to create the shared memory segment");
+        free(arena);
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        perror("Failed to size the shared memory segment");
+        close(fd);
+        shm_unlink(arena -> name);
+        free(arena);
+        return NULL;
+    }
+    arena -> base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the segment
+    if (arena -> base == MAP_FAILED) {
+        perror("Failed to map the shared memory segment");
+        shm_unlink(arena -> name);
+        free(arena);
+        return NULL;
+    }
+    arena -> size = size;
+    arena -> used = 0;
+    return arena;
+}
+
+// Round 'size' up to a whole number of cache lines, so what comes after it starts on a new line
+// (every piece of an arena, and of the blocks createProducers lays out).
+size_t cacheAlignedSize(size_t size) {
+    return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+// Take 'size' zeroed bytes from the arena, aligned to a cache line. Returns NULL if it is full.
+void* allocateSharedArena(SharedArena* arena, size_t size) {
+    size = cacheAlignedSize(size);
+    if (size > arena -> size - arena -> used) {
+        return NULL;
+    }
+    void* piece = arena -> base + arena -> used;
+    arena -> used += size;
+    return piece;
+}
+
+// Destructor for SharedArena: unmaps it and removes its name (no process may use it anymore).
+void destructorSharedArena(SharedArena* arena) {
+    if (arena == NULL) {
+        return;
+    }
+    munmap(arena -> base, arena -> size);
+    shm_unlink(arena -> name);
+    free(arena);
+}
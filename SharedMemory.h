@@ -0,0 +1,9 @@
+#pragma once
+#ifndef TASK3_SHAREDMEMORY_H
+#define TASK3_SHAREDMEMORY_H
+#include "Structs.h"
+SharedArena* constructorSharedArena(size_t size);
+size_t cacheAlignedSize(size_t size);
+void* allocateSharedArena(SharedArena* arena, size_t size);
+void destructorSharedArena(SharedArena* arena);
+#endif //TASK3_SHAREDMEMORY_H
@@ -0,0 +1,158 @@
+# include "Stats.h"
+#include <signal.h>
+
+/*
+ * Per thread and per queue counters, compiled in only with -DINSTRUMENT.
+ * Every counter has a single writer (the thread itself, or the reader of the queue), so updating it is a plain
+ * relaxed load and store: no locked instruction and no shared cache line between two writers.
+ * The counters are printed to stderr when the pipeline ends, and whenever the process gets SIGUSR1.
+ * With "ProducerProcesses on" the producers count in their own copy of the process, and those counters are lost:
+ * only the pipeline's own threads (and its queues, counted by their readers) are printed.
+ */
+#ifdef INSTRUMENT
+
+_Thread_local ThreadStats* currentThreadStats = NULL;
+
+// All the registered threads and queues (only the lists are protected by the mutex, not the counters).
+pthread_mutex_t statsMutex = PTHREAD_MUTEX_INITIALIZER;
+// New entries are added at the end, so they are printed in the order they were created.
+ThreadStats* threadStatsList = NULL;
+ThreadStats** threadStatsEnd = &threadStatsList;
+QueueStats* queueStatsList = NULL;
+QueueStats** queueStatsEnd = &queueStatsList;
+
+// The thread that prints the counters on SIGUSR1.
+pthread_t statsSignalThread;
+atomic_int statsSignalRunning = 0;
+
+// Register the calling thread as thread 'index' of 'stage' and start counting.
+void startThreadStats(const char* stage, int index) {
+    ThreadStats* stats = calloc(1, sizeof(ThreadStats));
+    if (stats == NULL) {
+        return;
+    }
+    stats -> stage = stage;
+    stats -> index = index;
+    atomic_store(&stats -> startNs, getMonotonicNs());
+    pthread_mutex_lock(&statsMutex);
+    *threadStatsEnd = stats;
+    threadStatsEnd = &stats -> next;
+    pthread_mutex_unlock(&statsMutex);
+    currentThreadStats = stats;
+}
+
+// The calling thread is done (its counters stay until resetStats).
+void endThreadStats() {
+    if (currentThreadStats != NULL) {
+        atomic_store(&currentThreadStats -> endNs, getMonotonicNs());
+        currentThreadStats = NULL;
+    }
+}
+
+// Zero the counters of a new queue (it is not printed until it is registered).
+void initQueueStats(QueueStats* stats) {
+    stats -> name = NULL;
+    stats -> index = 0;
+    atomic_init(&stats -> removed, 0);
+    atomic_init(&stats -> highWater, 0);
+    atomic_init(&stats -> timesFull, 0);
+    stats -> next = NULL;
+}
+
+// Register the counters of a queue (they live inside the queue, unregister with resetStats before destroying it).
+void registerQueueStats(QueueStats* stats, const char* name, int index) {
+    stats -> name = name;
+    stats -> index = index;
+    pthread_mutex_lock(&statsMutex);
+    stats -> next = NULL;
+    *queueStatsEnd = stats;
+    queueStatsEnd = &stats -> next;
+    pthread_mutex_unlock(&statsMutex);
+}
+
+// Print all the counters. Safe while the pipeline runs (the numbers are then only a snapshot).
+void printStats(FILE* file) {
+    long long now = getMonotonicNs();
+    pthread_mutex_lock(&statsMutex);
+    fprintf(file, "Threads:\n");
+    for (ThreadStats* stats = threadStatsList; stats != NULL; stats = stats -> next) {
+        long long end = atomic_load(&stats -> endNs);
+        long long runNs = (end != 0 ? end : now) - atomic_load(&stats -> startNs);
+        long long blockedNs = atomic_load(&stats -> blockedNs);
+        fprintf(file, "  %-10s %3d: in %10lld, out %10lld, %8lld waits, blocked %9.3f ms, busy %9.3f ms (%5.1f%%)%s\n",
+                stats -> stage, stats -> index, atomic_load(&stats -> dequeued), atomic_load(&stats -> enqueued),
+                atomic_load(&stats -> waits), blockedNs / 1e6, (runNs - blockedNs) / 1e6,
+                runNs > 0 ? 100.0 * (runNs - blockedNs) / runNs : 0.0, end != 0 ? "" : " running");
+    }
+    fprintf(file, "Queues:\n");
+    for (QueueStats* stats = queueStatsList; stats != NULL; stats = stats -> next) {
+        fprintf(file, "  %-10s %3d: %10lld articles, high water %6lld, full %8lld times\n",
+                stats -> name, stats -> index, atomic_load(&stats -> removed), atomic_load(&stats -> highWater),
+                atomic_load(&stats -> timesFull));
+    }
+    pthread_mutex_unlock(&statsMutex);
+    fflush(file);
+}
+
+// Forget all the registered threads and queues.
+void resetStats() {
+    pthread_mutex_lock(&statsMutex);
+    ThreadStats* stats = threadStatsList;
+    while (stats != NULL) {
+        ThreadStats* next = stats -> next;
+        free(stats);
+        stats = next;
+    }
+    threadStatsList = NULL;
+    threadStatsEnd = &threadStatsList;
+    queueStatsList = NULL;
+    queueStatsEnd = &queueStatsList;
+    pthread_mutex_unlock(&statsMutex);
+}
+
+// Waits for SIGUSR1 and prints the counters, until stopStatsSignalThread.
+void* statsSignalLoop(void* arg) {
+    sigset_t* signals = (sigset_t*)arg;
+    int signal;
+    while (sigwait(signals, &signal) == 0 && atomic_load(&statsSignalRunning)) {
+        printStats(stderr);
+    }
+    free(signals);
+    return NULL;
+}
+
+// Block SIGUSR1 in the calling thread: the threads and processes created after this inherit the mask,
+// so the signal only ever goes to the thread that waits for it.
+void blockStatsSignal() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+}
+
+// Start the thread that waits for SIGUSR1 (after blockStatsSignal).
+void startStatsSignalThread() {
+    sigset_t* signals = malloc(sizeof(sigset_t));
+    if (signals == NULL) {
+        return;
+    }
+    sigemptyset(signals);
+    sigaddset(signals, SIGUSR1);
+    atomic_store(&statsSignalRunning, 1);
+    if (pthread_create(&statsSignalThread, NULL, statsSignalLoop, signals) != 0) {
+        atomic_store(&statsSignalRunning, 0);
+        free(signals);
+    }
+}
+
+// Stop the SIGUSR1 thread (wakes it with one last SIGUSR1 that it ignores).
+void stopStatsSignalThread() {
+    if (!atomic_load(&statsSignalRunning)) {
+        return;
+    }
+    atomic_store(&statsSignalRunning, 0);
+    pthread_kill(statsSignalThread, SIGUSR1);
+    pthread_join(statsSignalThread, NULL);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+#ifndef TASK3_STATS_H
+#define TASK3_STATS_H
+#include "Structs.h"
+
+/*
+ * Instrumentation counters, only compiled in with -DINSTRUMENT (make INSTRUMENT=1, or cmake -DTASK3_INSTRUMENT=ON).
+ * Without it every STATS_* macro is empty and the counters don't exist.
+ */
+#ifdef INSTRUMENT
+
+// The counters of the calling thread (NULL if it didn't call startThreadStats).
+extern _Thread_local ThreadStats* currentThreadStats;
+
+// Add to a counter that only one thread writes: a plain load and store, no locked instruction.
+static inline void addStat(atomic_llong* counter, long long value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+static inline void maxStat(atomic_llong* counter, long long value) {
+    if (value > atomic_load_explicit(counter, memory_order_relaxed)) {
+        atomic_store_explicit(counter, value, memory_order_relaxed);
+    }
+}
+
+static inline void addThreadEnqueued(long long count) {
+    if (currentThreadStats != NULL) {
+        addStat(&currentThreadStats -> enqueued, count);
+    }
+}
+
+static inline void addThreadDequeued(long long count) {
+    if (currentThreadStats != NULL) {
+        addStat(&currentThreadStats -> dequeued, count);
+    }
+}
+
+static inline void addThreadBlocked(long long ns) {
+    if (currentThreadStats != NULL) {
+        addStat(&currentThreadStats -> waits, 1);
+        addStat(&currentThreadStats -> blockedNs, ns);
+    }
+}
+
+// 'removed' articles were just removed from a queue that held 'depth' articles (of 'size', 0 = unbounded).
+// Called by the reader (or under the queue's lock), so there is a single writer here too.
+static inline void updateQueueStats(QueueStats* stats, int removed, long long depth, int size) {
+    if (removed == 0) {
+        return;
+    }
+    addThreadDequeued(removed);
+    addStat(&stats -> removed, removed);
+    maxStat(&stats -> highWater, depth);
+    if (size > 0 && depth >= size) {
+        addStat(&stats -> timesFull, 1);
+    }
+}
+
+void startThreadStats(const char* stage, int index);
+void endThreadStats();
+void initQueueStats(QueueStats* stats);
+void registerQueueStats(QueueStats* stats, const char* name, int index);
+void printStats(FILE* file);
+void blockStatsSignal();
+void startStatsSignalThread();
+void stopStatsSignalThread();
+void resetStats();
+
+#define STATS_THREAD_START(stage, index) startThreadStats(stage, index)
+#define STATS_THREAD_END() endThreadStats()
+#define STATS_ENQUEUED(count) addThreadEnqueued(count)
+#define STATS_BLOCKED(ns) addThreadBlocked(ns)
+#define STATS_QUEUE_INIT(buffer) initQueueStats(&(buffer) -> stats)
+#define STATS_QUEUE_REGISTER(buffer, name, index) registerQueueStats(&(buffer) -> stats, name, index)
+#define STATS_QUEUE_REMOVED(buffer, removed, depth, size) updateQueueStats(&(buffer) -> stats, removed, depth, size)
+#define STATS_BLOCK_SIGNAL() blockStatsSignal()
+#define STATS_START() startStatsSignalThread()
+#define STATS_FINISH(file) do { stopStatsSignalThread(); printStats(file); resetStats(); } while (0)
+
+#else
+
+#define STATS_THREAD_START(stage, index) ((void)0)
+#define STATS_THREAD_END() ((void)0)
+#define STATS_ENQUEUED(count) ((void)0)
+#define STATS_BLOCKED(ns) ((void)0)
+#define STATS_QUEUE_INIT(buffer) ((void)0)
+#define STATS_QUEUE_REGISTER(buffer, name, index) ((void)0)
+#define STATS_QUEUE_REMOVED(buffer, removed, depth, size) ((void)0)
+#define STATS_BLOCK_SIGNAL() ((void)0)
+#define STATS_START() ((void)0)
+#define STATS_FINISH(file) ((void)0)
+
+#endif
+#endif //TASK3_STATS_H
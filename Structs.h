@@ -6,76 +6,626 @@
 #ifndef TASK3_STRUCTS_H
 #define TASK3_STRUCTS_H
 
+// For sem_clockwait, usleep, writev... (the Makefile compiles with -std=c11 which hides them)
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
 
-#define NUM_ARTICLES_TYPES 3
-extern char* types[NUM_ARTICLES_TYPES];
+// The article types come from the config ("Types ...", see ProcessConfig.c), the default is defaultTypes.
+// An article only carries the index of its type, so routing it is an array index however many types there are.
+#define DEFAULT_NUM_ARTICLE_TYPES 3
+// The journal keeps the type of a record in 16 bits.
+#define MAX_ARTICLE_TYPES 65535
+extern char* defaultTypes[DEFAULT_NUM_ARTICLE_TYPES];
+// The types of the running pipeline (set by runPipeline from its config)
+extern char** types;
+extern int numArticleTypes;
+
+// Flags of an Article.
+#define ARTICLE_DONE 1 // Not a real article: the sender has nothing more to send
+
+// The times an article passes through the stages (see Tracing.c).
+// STAMP_CREATED is always set, the others only when tracing is on.
+typedef enum {
+    STAMP_CREATED, // The producer created it
+    STAMP_DISPATCHED, // The dispatcher moved it to the queue of its type
+    STAMP_EDIT_START, // A co-editor started editing it
+    STAMP_EDIT_END, // The co-editor is done with it
+    STAMP_OUTPUT, // The manager wrote it
+    NUM_ARTICLE_STAMPS
+} ArticleStamp;
+
+// An article as it moves through the pipeline. It is only turned into text by the manager.
+typedef struct {
+    int producerId;
+    int type; // Index in 'types'
+    int sequence; // Number of articles of this type the producer created before this one
+    int flags;
+    long long stamps[NUM_ARTICLE_STAMPS]; // Monotonic clock, nanoseconds
+} Article;
+
+// The "DONE" message every stage sends when it has nothing more to send.
+extern Article DoneArticle;
+
+static inline int isDoneArticle(const Article* article) {
+    return (article -> flags & ARTICLE_DONE) != 0;
+}
+
+// Current time of the monotonic clock in nanoseconds.
+static inline long long getMonotonicNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Fields written by different threads are kept on different cache lines so they don't bounce between cores.
+#define CACHE_LINE_SIZE 64
+
+// A named shared memory segment (shm_open + mmap) that hands out memory a piece at a time (see SharedMemory.c).
+// It is mapped before the producer processes are forked, so a pointer into it is the same in every process.
+typedef struct {
+    char name[64]; // The shm_open name
+    char* base;
+    size_t size;
+    size_t used; // Only the process that created it allocates
+} SharedArena;
+
+// Counters of a single queue (see Stats.c). Only updated by the reader side (or under the queue's lock),
+// and only when compiled with -DINSTRUMENT. Whatever was inserted and not removed yet is still in the queue.
+typedef struct QueueStats {
+    const char* name;
+    int index;
+    atomic_llong removed; // Number of articles removed
+    atomic_llong highWater; // Most articles ever seen waiting at once
+    atomic_llong timesFull; // Number of removes that found the buffer full
+    struct QueueStats* next; // Next registered queue
+} QueueStats;
+
+// Counters of a single thread (see Stats.c). Only updated by the thread itself.
+typedef struct ThreadStats {
+    const char* stage;
+    int index;
+    atomic_llong enqueued; // Number of articles the thread inserted to a queue
+    atomic_llong dequeued; // Number of articles the thread removed from a queue
+    atomic_llong waits; // Number of times it went to sleep in a semaphore
+    atomic_llong blockedNs; // Time it spent sleeping in a semaphore
+    atomic_llong startNs;
+    atomic_llong endNs; // 0 while the thread is running
+    struct ThreadStats* next; // Next registered thread
+} ThreadStats;
+
+// Which implementation a BoundedBuffer uses.
+typedef enum {
+    BUFFER_LOCKED, // Any number of writers and readers, guarded by mutexSemaphore
+    BUFFER_SPSC, // Exactly one writer and one reader, lock-free ring (see Queue.c)
+    BUFFER_MPSC // Many writers and one reader, lock-free slots with sequence numbers (see Queue.c)
+} BufferKind;
+
+// How a thread waits for a queue that is empty (or full). See waitSemaphoreWith in Queue.c.
+typedef enum {
+    WAIT_BLOCKING, // Sleep in the semaphore right away (no CPU used while waiting)
+    WAIT_ADAPTIVE // Spin a little, then yield, and only then sleep (lower wakeup latency, fewer syscalls)
+} WaitStrategy;
+
+// Counting semaphore that is posted and taken by a whole batch with a single atomic operation (see Queue.c).
+// A POSIX semaphore only moves by one, so a batch of n articles cost n sem_post and n sem_trywait.
+typedef struct {
+    atomic_uint value; // Units that can be taken. Also the futex word the sleepers wait on while it is 0
+    atomic_int waiters; // Threads sleeping (or about to) in it
+    int shared; // Lives in memory shared between processes
+} BatchSemaphore;
+
+// The buffers of a single reader that may have articles: a bit per buffer, and a bit per word of those (see ReadySet.c).
+typedef struct {
+    atomic_ullong* words; // A bit per member, set by its writer
+    atomic_ullong* summary; // A bit per word of 'words' that has a bit set
+    int numWords;
+    int numSummary;
+    SharedArena* arena; // Where the bitmaps are (NULL = malloc)
+    BatchSemaphore wake; // Posted by a mark that sets a summary bit, the reader sleeps on it
+} ReadySet;
+
+// The queues of the pipeline, to choose a WaitStrategy for each of them in the config.
+typedef enum {
+    QUEUE_PRODUCER, // Producer -> dispatcher (and the dispatcher's ready set)
+    QUEUE_DISPATCHER, // Dispatcher -> co-editors
+    QUEUE_SHARED, // Co-editors -> manager
+    NUM_QUEUE_STAGES
+} QueueStage;
+
+// The thread groups of the pipeline, to choose the CPUs of each of them in the config (see Affinity.c).
+typedef enum {
+    STAGE_PRODUCERS, // The producer worker threads
+    STAGE_DISPATCHERS, // One thread per dispatcher shard
+    STAGE_COEDITORS,
+    STAGE_MANAGER,
+    NUM_THREAD_STAGES
+} ThreadStage;
 
 typedef struct {
-    char **buffer;
+    Article **buffer;
     int size;
+    // SPSC and MPSC: the ring has mask + 1 slots (size rounded up to a power of two), position 'p' is in slot
+    // 'p & mask'. SPSC holds at most 'size' articles, MPSC as many as it has slots.
+    unsigned int mask;
     int in; // Next place to insert
     int out; // Next place to remove
     sem_t mutexSemaphore; // Binary semaphore (basic lock)
-    sem_t slotsSemaphore; // Counting semaphore (counting free slots)
-    sem_t articlesSemaphore; // Counting semaphore (counting articles)
+    BatchSemaphore slotsSemaphore; // Counting semaphore (counting free slots). SPSC: the writer sleeps on it when full
+    // Counting semaphore (counting articles). SPSC and MPSC: the reader sleeps on it when empty
+    BatchSemaphore articlesSemaphore;
+    // Locked and MPSC, optional: posted after every insert so the reader knows some buffer has data
+    BatchSemaphore* readySemaphore;
+    ReadySet* readySet; // SPSC, optional: where an insert marks it (as member 'readyIndex') for its reader
+    int readyIndex;
+    int shared; // It lives in a SharedArena: its semaphores are process-shared and the arena owns its memory
+    int borrowed; // Its memory belongs to an arena or to a block of the caller, the destructor doesn't free it
+    // SPSC, optional: called by the reader instead of posting slotsSemaphore when the writer is a task
+    // that stopped on a full ring (see armBoundedBufferWriter).
+    void (*writerWakeup)(void* arg);
+    void* writerWakeupArg;
+    BufferKind kind;
+    WaitStrategy waitStrategy; // How both sides wait when it is full or empty
+    atomic_uint* sequences; // MPSC only. Per slot: 2 * the position it is free for, + 1 once written (mod 2^32)
+    // SPSC and MPSC. Written by the writer(s).
+    _Alignas(CACHE_LINE_SIZE) atomic_uint tail; // Number of articles inserted (MPSC: slots claimed) so far
+    unsigned int cachedHead; // Writer's last seen copy of 'head', so it doesn't read the reader's line on every insert
+    // SPSC and MPSC. Written by the reader.
+    _Alignas(CACHE_LINE_SIZE) atomic_uint head; // Number of articles removed so far
+    unsigned int cachedTail; // Reader's last seen copy of 'tail'
+    atomic_uint freedEpoch; // MPSC only. Moved by the reader when it frees slots while writers sleep on it (a futex)
+    // Set by a side before it goes to sleep, cleared by the side that wakes it.
+    // MPSC: writerWaiting is the number of writers sleeping on freedEpoch instead.
+    _Alignas(CACHE_LINE_SIZE) atomic_int writerWaiting;
+    atomic_int readerWaiting;
+    atomic_int readyMarked; // Set by the writer when it marks the buffer in 'readySet', cleared by the reader
+#ifdef INSTRUMENT
+    _Alignas(CACHE_LINE_SIZE) QueueStats stats;
+#endif
 } BoundedBuffer;
 
+// Number of articles in one segment of an UnboundedBuffer.
+#define SEGMENT_SIZE 64
+// How many empty segments an UnboundedBuffer keeps for reuse (more than that are freed).
+#define MAX_FREE_SEGMENTS 4
+
+// The UnboundedBuffer is a linked list of fixed size segments.
+typedef struct UnboundedSegment {
+    Article* buffer[SEGMENT_SIZE];
+    struct UnboundedSegment* next;
+} UnboundedSegment;
+
 typedef struct {
-    char **buffer;
-    int size;
-    int in; // Next place to insert
-    int out; // Next place to remove
+    UnboundedSegment* head; // The segment we remove from (the oldest one)
+    UnboundedSegment* tail; // The segment we insert to (the newest one)
+    int in; // Next place to insert (in the tail segment)
+    int out; // Next place to remove (in the head segment)
+    UnboundedSegment* freeSegments; // Segments that were emptied, kept so we don't malloc again
+    int numFreeSegments;
+    WaitStrategy waitStrategy; // How the readers (and the writers, when it has a limit) wait
+    int limit; // Max number of articles it holds, 0 = no limit
     sem_t mutexSemaphore; // Binary semaphore (basic lock)
-    sem_t slotsSemaphore; // Counting semaphore (counting free slots)
-    sem_t articlesSemaphore; // Counting semaphore (counting articles)
+    BatchSemaphore slotsSemaphore; // Counting semaphore (counting free slots). Only used when it has a limit
+    BatchSemaphore articlesSemaphore; // Counting semaphore (counting articles)
+#ifdef INSTRUMENT
+    QueueStats stats;
+#endif
 } UnboundedBuffer;
 
-// This struct holds the information for a single producer.
+struct ArticlePool;
+
+// One pooled article. Only 'article' moves through the queues, the rest is found back from it (see ArticlePool.c).
+typedef struct ArticleBlock {
+    struct ArticleBlock* next; // Next block in a free list
+    struct ArticlePool* pool; // The pool this block is returned to
+    Article article;
+} ArticleBlock;
+
+// A single malloc'ed chunk of blocks, kept in a list so the pool can free it at the end.
+typedef struct ArticleSlab {
+    struct ArticleSlab* next;
+    int count;
+    ArticleBlock blocks[];
+} ArticleSlab;
+
+// Allocation statistics of a pool (or of all the pools together).
 typedef struct {
+    long slabs; // Number of mallocs the pool did
+    long capacity; // Number of blocks in all the slabs
+    long allocations; // Number of articles handed out
+    long returns; // Number of articles that came back from other threads
+} ArticlePoolStats;
+
+// Articles of a single producer. Only the producer allocates from it, any thread may give articles back.
+typedef struct ArticlePool {
+    ArticleBlock* freeList; // Owner only: blocks ready to be handed out
+    ArticleSlab* slabs; // Owner only: everything we malloc'ed
+    int slabSize; // Number of blocks in the next slab we malloc
+    ArticlePoolStats stats; // Owner only
+    SharedArena* arena; // Where the slabs come from (NULL = malloc)
+    int limit; // Max number of articles it ever mallocs (its credits), 0 = no limit
+    // Called when an article comes back while the owner waits for one (see armArticlePool)
+    void (*ownerWakeup)(void* arg);
+    void* ownerWakeupArg;
+    _Alignas(CACHE_LINE_SIZE) _Atomic(ArticleBlock*) returned; // Lock-free stack of blocks given back by other threads
+    atomic_int ownerWaiting; // Set by the owner when it is out of credits
+} ArticlePool;
+
+// Number of articles a producer creates before it inserts them to its buffer.
+#define PRODUCER_BATCH 8
+
+// Where a producer task is (see ProducerScheduler.c).
+typedef enum {
+    TASK_RUNNING, // In the run queue or running on a worker
+    TASK_PARKED, // Stopped on a full buffer, the dispatcher schedules it again when it frees a slot
+    TASK_NOTIFIED, // Woken while it was still running, so it must not park
+    TASK_FINISHED // Sent its "DONE"
+} TaskState;
+
+struct ProducerScheduler;
+
+// This struct holds the information for a single producer.
+// A producer is not a thread but a task that the scheduler's workers run a piece at a time,
+// so everything it needs to continue where it stopped is kept here.
+typedef struct Producer {
     int id; // ID to identify each producer
     int NumArticles; // The number of articles this producer will generate
     int QueueLength; // The size of the buffer for this producer
-    BoundedBuffer* ProducerBuffer; // The buffer for this producer needs to be bounded
+    int isDone; // Set by the dispatcher once it read this producer's "DONE"
+    BoundedBuffer* ProducerBuffer; // The buffer for this producer needs to be bounded (NULL with direct routing)
+    BoundedBuffer** lanes; // Direct routing: a buffer per type, each read by a co-editor (else NULL)
+    ArticlePool* pool; // The memory of this producer's articles
+    // Task state, only touched by the worker running it
+    int produced; // Number of articles created so far
+    int* articleCounts; // Number of articles of each type created so far
+    Article* batch[PRODUCER_BATCH]; // Created articles that are not in the buffer yet
+    int batchCount;
+    int batchSent; // How many of 'batch' are already in the buffer
+    int sentDone; // "DONE" is in 'batch' (or already in the buffer)
+    int doneLanes; // Direct routing: number of lanes that already got the "DONE"
+    // Scheduling
+    atomic_int taskState; // A TaskState
+    struct Producer* nextTask; // Next in the run queue
+    struct ProducerScheduler* scheduler;
 } Producer;
 
+// The settings of one producer in the config file.
+typedef struct {
+    int id; // ID to identify the producer (from 0, it is 1 in the file)
+    int NumArticles; // The number of articles this producer will generate
+    int QueueLength; // The size of the buffer for this producer
+} ProducerConfig;
+
+// A position in the mapped config file (see processConfig).
+typedef struct {
+    const char* next;
+    const char* end;
+    int line; // Line of 'next', from 1
+} ConfigScanner;
+
 // This struct holds the entire configuration.
 typedef struct {
-    Producer* ArrayProducers; // Array of producer configurations
+    ProducerConfig* ArrayProducers; // Array of producer configurations
     int TotalNumProducers; // Number of producers ( The last ID of the last producer is the number of producers)
     int QueueLengthCoEditor; // Size of the co-editor queue
+    char** Types; // Names of the article types (optional, default defaultTypes)
+    int NumTypes;
+    int* CoEditorWorkers; // Number of co-editor threads for each type (optional in the file, default 1)
+    int OutputFlushBytes; // The manager writes its output once this much is waiting (optional, default OUTPUT_FLUSH_BYTES)
+    int OutputFlushMs; // ...or once the oldest waiting line is this old (optional, default OUTPUT_FLUSH_MS)
+    int EditDelayUsec; // How long a co-editor takes to edit an article (optional, default EDIT_DELAY_USEC)
+    int Tracing; // Record the per hop latencies of the articles (optional, default off)
+    WaitStrategy WaitStrategies[NUM_QUEUE_STAGES]; // How every queue waits (optional, default WAIT_BLOCKING)
+    int ProducerWorkers; // Threads that run the producers (optional, default 0 = one per CPU)
+    int Dispatchers; // Dispatcher threads, each owns a slice of the producers (optional, default 1)
+    int DispatcherQueueLimit; // Max articles in each dispatcher -> co-editor queue (optional, default 0 = no limit)
+    int AsyncEdits; // Edits in flight per co-editor thread, 0 = one edit at a time (optional, default 0)
+    int MemoryLimitKb; // Max kilobytes of articles in flight, split between the producers (optional, default 0 = no limit)
+    int AutoAffinity; // Place the stages on the CPU packages by themselves (optional, default off)
+    int StagePinned[NUM_THREAD_STAGES]; // The stage runs only on StageCpus (optional, default off)
+    cpu_set_t StageCpus[NUM_THREAD_STAGES];
+    int ProducerProcesses; // Every producer is a child process feeding a shared memory segment (optional, default off)
+    int DirectRouting; // Producers write straight to the co-editors (optional, default off, no ProducerProcesses/AsyncEdits)
+    char* JournalPath; // The manager also appends every article to this journal file (optional, default NULL = none)
+    int JournalSyncMs; // Interval between two msyncs of the journal (optional, default JOURNAL_SYNC_MS)
+    int* TypeWeights; // Share of the manager each type gets when they all wait (optional, default 1)
+    int* TypeDeadlineMs; // Max time from the producer to the output (optional, default 0 = none)
+    int ReorderWindow; // Max articles the manager holds back to write them in order (optional, default 0 = off)
+    int ReorderTimeoutMs; // ...and for how long (optional, default REORDER_TIMEOUT_MS)
 } Config;
 
+// Producers that run as child processes (see ProducerProcess.c).
+typedef struct {
+    Producer** producers;
+    int numProducers;
+    pid_t* pids; // 0 once the process was reaped
+    atomic_int* sentDone; // In the shared memory: a producer sets its flag once its "DONE" is in its buffer
+    sem_t* credits; // In the shared memory: a producer out of credits sleeps on its semaphore
+    pthread_t reaper;
+    int crashed; // Producers that died before they sent "DONE"
+} ProducerProcesses;
+
+// Which CPUs every thread of the pipeline may run on (see Affinity.c).
 typedef struct {
+    int pinned[NUM_THREAD_STAGES]; // Stages the config pinned by hand
+    cpu_set_t stageCpus[NUM_THREAD_STAGES];
+    int numPackages; // Automatic placement: the CPU packages (sockets) we may use, 0 = no automatic placement
+    cpu_set_t* packages;
+    int numShards; // Number of dispatcher shards, the producer workers follow them
+} Placement;
+
+// Runs the producer tasks on a fixed number of worker threads (see ProducerScheduler.c).
+typedef struct ProducerScheduler {
+    Producer* head; // Run queue (FIFO of tasks that can run)
+    Producer* tail;
+    sem_t mutexSemaphore; // Guards the run queue
+    BatchSemaphore readySemaphore; // Counting semaphore (one post per task in the run queue, plus one per worker to stop it)
+    atomic_int tasksLeft; // Tasks that didn't finish yet
+    atomic_int workersStarted; // Gives every worker its index
+    int numWorkers;
+    pthread_t* workers;
+} ProducerScheduler;
+
+struct Dispatcher;
+
+// A dispatcher thread and the contiguous slice of the producers only it reads (see Dispatcher.c).
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) struct Dispatcher* dispatcher;
+    int index;
+    int first; // Index in 'producers' of its first producer
+    int count; // Number of producers it owns
+    int doneCount; // Number of its producers that sent "DONE"
+    ReadySet ready; // Its producers buffers that may have articles (member i = producer first + i)
+    int* readyMembers; // Where it takes the marked members to (one per producer)
+    // Where it groups a batch by type (see sendToCoEditors)
+    Article** byType; // DISPATCHER_BATCH per type
+    int* typeCounts; // Per type, 0 except while a batch is grouped
+    int* batchTypes; // The types of the batch being grouped
+} DispatcherShard;
+
+typedef struct Dispatcher {
     Producer** producers;
     int TotalNumProducers;
     UnboundedBuffer** DispatcherBuffersArray; // The buffer for the Dispatcher needs to be unbounded
+    DispatcherShard* shards; // One per dispatcher thread
+    int numShards;
+    atomic_int shardsRunning; // Shards that still have producers that didn't send "DONE"
+    int tracing; // Stamp the articles it dispatches
+    WaitStrategy waitStrategy; // How it waits for its shards ready sets
+    SharedArena* arena; // The shards are in it when the producers are processes (NULL = malloc)
+    int* typeRanks; // Per type, its place in the order it inserts to the per-type queues (0 = most urgent)
 } Dispatcher;
 
+// Default max time the manager holds an article back waiting for the ones before it ("Reorder" in the config).
+#define REORDER_TIMEOUT_MS 100
+
+// Default thresholds of the manager's output.
+#define OUTPUT_FLUSH_BYTES 65536
+#define OUTPUT_FLUSH_MS 50
+// The output is kept in chunks of this size, a flush writes all of them with a single writev.
+#define OUTPUT_CHUNK_SIZE 16384
+// Longest line the manager writes ("Producer <id> <type> <sequence>\n").
+#define OUTPUT_MAX_LINE 128
+
+// Collects the manager's output lines and writes them in big pieces (see OutputWriter.c).
+typedef struct {
+    int fd; // Where the output goes
+    char** chunks;
+    size_t* chunkSizes; // Bytes used in each of the chunks before the current one
+    int numChunks;
+    int current; // The chunk we append to, the ones before it are full
+    size_t used; // Bytes used in the current chunk
+    size_t pending; // Bytes waiting in all the chunks
+    size_t flushBytes;
+    long long flushIntervalNs;
+    long long firstPendingNs; // When the oldest waiting line was added
+} OutputWriter;
+
+// The journal file (see Journal.c): a header, the type names, then one record per article.
+#define JOURNAL_MAGIC "T3JRNL01"
+#define JOURNAL_VERSION 1
+// The file grows by this much at a time (the space is allocated up front, the manager only copies into memory).
+#define JOURNAL_EXTENT_BYTES (16 * 1024 * 1024)
+// Default interval between two msyncs of the journal.
+#define JOURNAL_SYNC_MS 100
+
+// Start of the journal file. The records start at 'headerSize' (the type names are in between).
+typedef struct {
+    char magic[8]; // JOURNAL_MAGIC, not NUL terminated
+    uint32_t version;
+    uint32_t headerSize; // A multiple of 8
+    uint32_t numTypes; // Number of NUL terminated type names after this struct
+    uint32_t reserved;
+} JournalHeader;
+
+// A single article in the journal. 'length' is the size of the whole record and is written last,
+// so a record with length 0 is the end (the file is zero filled past the last record).
+typedef struct {
+    _Atomic uint32_t length;
+    int32_t producerId;
+    int32_t sequence;
+    uint16_t type; // Index in the type names of the header
+    uint16_t flags;
+    int64_t createdNs; // Monotonic clock
+    int64_t writtenNs; // When the manager wrote it
+} JournalRecord;
+
+// The manager's journal file, mapped into memory (see Journal.c).
 typedef struct {
-    BoundedBuffer* SharedBuffer; // Manager's buffer
+    int fd;
+    char* base; // The mapping of the whole file
+    size_t capacity; // Size of the file (and of the mapping)
+    size_t used; // Bytes written so far
+    size_t synced; // Bytes already msync'ed
+    long long syncIntervalNs;
+    long long firstUnsyncedNs; // When the oldest record that is not msync'ed yet was written
+    int failed; // Growing the file failed, nothing more is written
+} Journal;
+
+// A journal file mapped read only (see Journal.c), for the tools that scan it.
+typedef struct {
+    char* base;
+    size_t size;
+    const char** typeNames; // Point into the mapping
+    int numTypes;
+} JournalView;
+
+// Log-bucketed histogram of nanosecond values (see Histogram.c).
+// Every power of two is split into HISTOGRAM_SUB_BUCKETS buckets, so a value is known within ~3%.
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS) * HISTOGRAM_SUB_BUCKETS)
+typedef struct {
+    long long counts[HISTOGRAM_BUCKETS];
+    long long total; // Number of values recorded
+    long long max;
+} Histogram;
+
+// The time between two stamps of an article (see Tracing.c).
+typedef enum {
+    HOP_PRODUCER_QUEUE, // Created -> dispatched
+    HOP_DISPATCHER_QUEUE, // Dispatched -> edit start
+    HOP_EDIT, // Edit start -> edit end
+    HOP_SHARED_QUEUE, // Edit end -> output
+    HOP_TOTAL, // Created -> output
+    NUM_TRACE_HOPS
+} TraceHop;
+
+// Histograms of every hop of every article type. Only the manager writes to it.
+typedef struct {
+    Histogram* hops[NUM_TRACE_HOPS]; // Per hop, one per type
+} Tracer;
+
+// How the manager picks the next article from its lanes (see ManagerLanes.c).
+typedef enum {
+    LANES_WEIGHTED, // Deficit round robin: 'weight' articles of a type, then the next type
+    LANES_DEADLINE // Earliest deadline first among the oldest article of every type
+} LanePolicy;
+
+// The lane of a single type to the manager.
+typedef struct {
+    BoundedBuffer* buffer; // MPSC, written by the co-editors of the type
+    int weight;
+    long long deadlineNs; // Max time from the producer to the output, 0 = none
+    // Manager only
+    long long written; // Articles of the type written
+    long long missed; // ...and how many of them were written after their deadline
+    long long worstLateNs;
+} ManagerLane;
+
+// The co-editors -> manager queue split into a lane per type, when the config gives the types priorities or deadlines.
+typedef struct {
+    ManagerLane* lanes; // One per type
+    BatchSemaphore readySemaphore; // Counting semaphore (one post per article waiting in any of the lanes)
+    WaitStrategy waitStrategy; // How the manager waits on readySemaphore
+    LanePolicy policy;
+    long long longestDeadlineNs; // LANES_DEADLINE: what a type without a deadline is ordered by
+    // Manager only
+    int current; // LANES_WEIGHTED: the lane being drained
+    int credit; // LANES_WEIGHTED: articles it may still take from 'current'
+} ManagerLanes;
+
+// An article the manager holds back until the ones before it are written (see Reorder.c).
+typedef struct ReorderNode {
+    Article* article;
+    long long arrivedNs;
+    struct ReorderNode* nextInKey; // The next held article of the same producer and type (higher sequence)
+    struct ReorderNode* older; // All the held articles, in the order they came (also the free list)
+    struct ReorderNode* newer;
+} ReorderNode;
+
+// Puts the articles of every producer and type back in the order they were created (only the manager uses it).
+typedef struct {
+    int numKeys; // (highest producer id + 1) * numArticleTypes, a key is producerId * numArticleTypes + type
+    int* nextSequence; // Per key: the sequence to write next
+    ReorderNode** held; // Per key: its held articles, lowest sequence first
+    ReorderNode* nodes; // 'window' of them
+    ReorderNode* freeNodes;
+    ReorderNode* oldest; // The held article that came first
+    ReorderNode* newest;
+    int window; // Max number of held articles
+    int numHeld;
+    long long timeoutNs; // Max time an article is held
+    void (*emit)(void* arg, Article* article, long long now); // Writes an article that is next in its order
+    void* emitArg;
+    long long reordered; // Articles that had to wait for others
+    long long gaps; // Times it stopped waiting for a missing article (the timeout passed or the window was full)
+    long long late; // Articles that came after it stopped waiting for them (written out of order)
+    int highWater; // Max number of articles held at once
+} ReorderBuffer;
+
+typedef struct {
+    BoundedBuffer* SharedBuffer; // Manager's buffer (NULL when it has lanes)
+    ManagerLanes* lanes; // Its buffer split by type (NULL when it has a single SharedBuffer)
+    OutputWriter* writer; // Manager's output
+    Journal* journal; // Optional: the binary record of every article (NULL = none)
+    Histogram* latencies; // Optional: where to record the end to end latency of every article
+    Tracer* tracer; // Per hop latencies, NULL when tracing is off
+    ReorderBuffer* reorder; // Writes every producer's articles of a type in order (NULL = as they come)
     sem_t doneSemaphore; // Semaphore for the "DONE" messages
     int doneCount; // Count of "DONE" messages
     int TotalNumProducers;
 } Manager;
 
+struct CoEditorLanes;
+
+// The co-editors of a single type. All of its threads read from the same dispatcher queue.
 typedef struct {
+    int type; // The article type these threads edit
     UnboundedBuffer* dispatcherBuffer;
     BoundedBuffer* SharedBuffer;
+    int numWorkers; // Number of threads editing this type
+    int batchSize; // Max number of articles a thread takes from dispatcherBuffer at once
+    int editDelayUsec; // How long editing an article takes
+    int tracing; // Stamp the articles it edits
+    int maxInFlight; // Async mode: edits a single thread keeps in flight (0 = a thread sleeps through every edit)
+    atomic_int workersLeft; // Threads of this type that didn't see "DONE" yet
+    struct CoEditorLanes* lanes; // Direct routing: what each of its threads reads (NULL otherwise)
 } CoEditor;
 
+// Direct routing: the lanes of this type that a single co-editor thread reads (see directCoEditorThread).
+typedef struct CoEditorLanes {
+    CoEditor* coEditor;
+    int index; // Of the thread among the threads of its type
+    BoundedBuffer** lanes; // One per producer it owns
+    int* laneDone; // Set once the lane's "DONE" was read
+    int numLanes;
+    int doneCount; // Number of its lanes that sent "DONE"
+    ReadySet ready; // Its lanes that may have articles (member i = lanes[i])
+    int* readyMembers; // Where it takes the marked members to (one per lane)
+} CoEditorLanes;
+
 #include "Producer.h"
+#include "ProducerScheduler.h"
 #include "ProcessConfig.h"
+#include "Stats.h"
+#include "Affinity.h"
+#include "SharedMemory.h"
+#include "ProducerProcess.h"
+#include "Histogram.h"
+#include "Tracing.h"
 #include "Queue.h"
+#include "ArticlePool.h"
+#include "OutputWriter.h"
+#include "Journal.h"
 #include "Dispatcher.h"
 #include "CoEditor.h"
+#include "ManagerLanes.h"
+#include "Reorder.h"
+#include "ReadySet.h"
 #include "manager.h"
 #include "initThreads.h"
 #include "initStructsObjects.h"
 #include "FreeResource.h"
+#include "Pipeline.h"
 #endif //TASK3_STRUCTS_H
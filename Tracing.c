@@ -0,0 +1,78 @@
+# include "Tracing.h"
+
+/*
+ * Per hop latency tracing ("Tracing on" in the config).
+ * Every stage writes the time into the article itself (one clock read per batch where it can), so the stages
+ * share nothing new. The manager, which sees every article last, turns the stamps into hops and adds them
+ * to a histogram per hop and per type. Nothing is allocated per article.
+ */
+
+const char* traceHopNames[NUM_TRACE_HOPS] = {"producer queue", "dispatcher queue", "edit", "shared queue", "total"};
+
+// Constructor of a Tracer with empty histograms.
+Tracer* constructorTracer() {
+    Tracer* tracer = malloc(sizeof(Tracer));
+    if (tracer == NULL) {
+        perror("Failed to allocate memory for Tracer");
+        return NULL;
+    }
+    for (int hop = 0; hop < NUM_TRACE_HOPS; ++hop) {
+        tracer -> hops[hop] = malloc(numArticleTypes * sizeof(Histogram));
+        if (tracer -> hops[hop] == NULL) {
+            perror("Failed to allocate memory for Tracer");
+            exit(-1);
+        }
+        for (int type = 0; type < numArticleTypes; ++type) {
+            clearHistogram(&tracer -> hops[hop][type]);
+        }
+    }
+    return tracer;
+}
+
+// Add the hops of an article that has all its stamps (called by the manager when it writes it).
+void recordArticleTrace(Tracer* tracer, const Article* article) {
+    const long long* stamps = article -> stamps;
+    int type = article -> type;
+    recordHistogram(&tracer -> hops[HOP_PRODUCER_QUEUE][type], stamps[STAMP_DISPATCHED] - stamps[STAMP_CREATED]);
+    recordHistogram(&tracer -> hops[HOP_DISPATCHER_QUEUE][type], stamps[STAMP_EDIT_START] - stamps[STAMP_DISPATCHED]);
+    recordHistogram(&tracer -> hops[HOP_EDIT][type], stamps[STAMP_EDIT_END] - stamps[STAMP_EDIT_START]);
+    recordHistogram(&tracer -> hops[HOP_SHARED_QUEUE][type], stamps[STAMP_OUTPUT] - stamps[STAMP_EDIT_END]);
+    recordHistogram(&tracer -> hops[HOP_TOTAL][type], stamps[STAMP_OUTPUT] - stamps[STAMP_CREATED]);
+}
+
+void printHistogramLine(const char* hop, const char* type, const Histogram* histogram, FILE* file) {
+    fprintf(file, "  %-16s %-8s %9lld  %10.1f %10.1f %10.1f %10.1f\n", hop, type, histogram -> total,
+            histogramPercentile(histogram, 0.5) / 1e3, histogramPercentile(histogram, 0.99) / 1e3,
+            histogramPercentile(histogram, 0.999) / 1e3, histogram -> max / 1e3);
+}
+
+// Print the percentiles of every hop, per type and for all the types together (microseconds).
+void printTracer(Tracer* tracer, FILE* file) {
+    fprintf(file, "Article latency (us):\n  %-16s %-8s %9s  %10s %10s %10s %10s\n",
+            "hop", "type", "articles", "p50", "p99", "p99.9", "max");
+    Histogram* all = constructorHistogram();
+    if (all == NULL) {
+        return;
+    }
+    for (int hop = 0; hop < NUM_TRACE_HOPS; ++hop) {
+        clearHistogram(all);
+        for (int type = 0; type < numArticleTypes; ++type) {
+            printHistogramLine(traceHopNames[hop], types[type], &tracer -> hops[hop][type], file);
+            mergeHistogram(all, &tracer -> hops[hop][type]);
+        }
+        printHistogramLine(traceHopNames[hop], "all", all, file);
+    }
+    destructorHistogram(all);
+    fflush(file);
+}
+
+// Destructor for Tracer
+void destructorTracer(Tracer* tracer) {
+    if (tracer == NULL) {
+        return;
+    }
+    for (int hop = 0; hop < NUM_TRACE_HOPS; ++hop) {
+        free(tracer -> hops[hop]);
+    }
+    free(tracer);
+}
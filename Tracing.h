@@ -0,0 +1,18 @@
+#pragma once
+#ifndef TASK3_TRACING_H
+#define TASK3_TRACING_H
+#include "Structs.h"
+
+// Stamp 'count' articles with the same time (one clock read for a whole batch).
+static inline void stampArticles(Article** articles, int count, ArticleStamp stamp, long long now) {
+    for (int i = 0; i < count; ++i) {
+        articles[i] -> stamps[stamp] = now;
+    }
+}
+
+Tracer* constructorTracer();
+void recordArticleTrace(Tracer* tracer, const Article* article);
+void printTracer(Tracer* tracer, FILE* file);
+void destructorTracer(Tracer* tracer);
+
+#endif //TASK3_TRACING_H
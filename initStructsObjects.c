@@ -1,45 +1,211 @@
 #include "initStructsObjects.h"
 
-// This function creates an array of producers as per the configuration provided
-Producer** createProducers(Config* config) {
-    Producer** ArrayProducers = malloc(config -> TotalNumProducers * sizeof(Producer*));
-    // Print the values in config
-    for (int i = 0; i < config -> TotalNumProducers; ++i) {
-        ArrayProducers[i] = malloc(sizeof(Producer)); // Allocate memory for each producer
-        ArrayProducers[i] -> id = config -> ArrayProducers[i].id; // Assign each producer its ID from configuration
-        ArrayProducers[i] -> NumArticles = config -> ArrayProducers[i].NumArticles;
+// The number of articles each producer may have in flight under the MemoryLimit (0 = no limit).
+// Every producer gets an equal share, and at least one article so it can always make progress.
+int producerCredits(Config* config) {
+    if (config -> MemoryLimitKb == 0 || config -> TotalNumProducers == 0) {
+        return 0;
+    }
+    long long credits = config -> MemoryLimitKb * 1024LL / sizeof(ArticleBlock) / config -> TotalNumProducers;
+    return credits > 0 ? (int)credits : 1;
+}
+
+// The bytes of producer 'i' in the block of createProducers: the Producer, its counters and its ring
+// (with direct routing its lane pointers and lanes, with an arena no ring), every piece on its own cache lines.
+size_t producerBlockBytes(Config* config, int i, SharedArena* arena) {
+    size_t size = cacheAlignedSize(sizeof(Producer)) + cacheAlignedSize(numArticleTypes * sizeof(int));
+    if (config -> DirectRouting) {
+        size += cacheAlignedSize(numArticleTypes * sizeof(BoundedBuffer*));
+        size += numArticleTypes * boundedBufferBytes(config -> ArrayProducers[i].QueueLength);
+    } else if (arena == NULL) {
+        size += boundedBufferBytes(config -> ArrayProducers[i].QueueLength);
+    }
+    return size;
+}
+
+// This function creates an array of producers as per the configuration provided.
+// The array and all the producers with their rings are one cache aligned block (one malloc, and the dispatcher
+// walks its producers in the order they are in memory), so freeing the array frees them all.
+// With an arena (producer processes) their buffers and pools are created in it.
+Producer** createProducers(Config* config, SharedArena* arena) {
+    int numProducers = config -> TotalNumProducers;
+    size_t arrayBytes = cacheAlignedSize(numProducers * sizeof(Producer*));
+    size_t blockBytes = arrayBytes;
+    for (int i = 0; i < numProducers; ++i) {
+        blockBytes += producerBlockBytes(config, i, arena);
+    }
+    char* block = aligned_alloc(CACHE_LINE_SIZE, blockBytes);
+    if (block == NULL) {
+        perror("Failed to allocate memory for the producers");
+        exit(-1);
+    }
+    Producer** ArrayProducers = (Producer**)block;
+    char* next = block + arrayBytes;
+    int credits = producerCredits(config);
+    for (int i = 0; i < numProducers; ++i) {
+        int queueLength = config -> ArrayProducers[i].QueueLength;
+        Producer* producer = (Producer*)next;
+        next += cacheAlignedSize(sizeof(Producer));
+        ArrayProducers[i] = producer;
+        producer -> id = config -> ArrayProducers[i].id; // Assign each producer its ID from configuration
+        producer -> NumArticles = config -> ArrayProducers[i].NumArticles;
+        producer -> QueueLength = queueLength;
+        producer -> isDone = 0;
+        producer -> articleCounts = (int*)next;
+        next += cacheAlignedSize(numArticleTypes * sizeof(int));
+        // The pool can hold all the articles of this producer, so it doesn't need to malloc while running
+        // (unless a memory limit gives it fewer credits).
+        if (arena != NULL) {
+            producer -> pool = constructorSharedArticlePool(producer -> NumArticles, credits, arena);
+        } else {
+            producer -> pool = constructorLimitedArticlePool(producer -> NumArticles, credits);
+        }
+        producer -> lanes = NULL;
+        if (config -> DirectRouting) {
+            // No dispatcher: a lane per type, only this producer writes to it and a single co-editor reads it.
+            producer -> ProducerBuffer = NULL;
+            producer -> lanes = (BoundedBuffer**)next;
+            next += cacheAlignedSize(numArticleTypes * sizeof(BoundedBuffer*));
+            for (int j = 0; j < numArticleTypes; ++j) {
+                producer -> lanes[j] = constructorSpscBoundedBufferIn(next, queueLength);
+                next += boundedBufferBytes(queueLength);
+                producer -> lanes[j] -> waitStrategy = config -> WaitStrategies[QUEUE_PRODUCER];
+                STATS_QUEUE_REGISTER(producer -> lanes[j], "lane", producer -> id);
+            }
+            if (producer -> pool == NULL) {
+                exit(-1);
+            }
+            continue;
+        }
         // Create a bounded buffer for each producer with the specified queue size
         // We create here in the main so the dispatcher wil have acess to it.
-        ArrayProducers[i]-> ProducerBuffer = constructorBoundedBuffer(config -> ArrayProducers[i].QueueLength);
+        // Only this producer writes to it and only the dispatcher reads from it, so it can be a lock-free SPSC ring.
+        if (arena != NULL) {
+            producer -> ProducerBuffer = constructorSharedSpscBoundedBuffer(queueLength, arena);
+        } else {
+            producer -> ProducerBuffer = constructorSpscBoundedBufferIn(next, queueLength);
+            next += boundedBufferBytes(queueLength);
+        }
+        if (producer -> pool == NULL || producer -> ProducerBuffer == NULL) {
+            exit(-1);
+        }
+        producer -> ProducerBuffer -> waitStrategy = config -> WaitStrategies[QUEUE_PRODUCER];
+        STATS_QUEUE_REGISTER(producer -> ProducerBuffer, "producer", producer -> id);
     }
     return ArrayProducers;
 }
 
 // This function creates an array of unbounded buffers for the dispatcher.
-UnboundedBuffer** createDispatcherBuffers() {
-    UnboundedBuffer** DispatcherBuffersArray = malloc(NUM_ARTICLES_TYPES * sizeof(UnboundedBuffer*));
-    for (int i = 0; i < NUM_ARTICLES_TYPES; ++i) {
-        // Create a bounded buffer for each type of message with the specified queue length.
-        DispatcherBuffersArray[i] = constructorUnboundedBuffer();
+UnboundedBuffer** createDispatcherBuffers(Config* config) {
+    UnboundedBuffer** DispatcherBuffersArray = malloc(numArticleTypes * sizeof(UnboundedBuffer*));
+    for (int i = 0; i < numArticleTypes; ++i) {
+        // Create a buffer for each type of message, bounded only if the config sets a limit.
+        DispatcherBuffersArray[i] = constructorLimitedUnboundedBuffer(config -> DispatcherQueueLimit);
+        DispatcherBuffersArray[i] -> waitStrategy = config -> WaitStrategies[QUEUE_DISPATCHER];
+        STATS_QUEUE_REGISTER(DispatcherBuffersArray[i], types[i], i);
     }
     return DispatcherBuffersArray;
 }
 
-// This function creates a Dispatcher.
-Dispatcher* createDispatcher(Producer** ArrayProducers, Config* config, UnboundedBuffer** DispatcherBuffersArray) {
+// This function creates a Dispatcher. With an arena (producer processes) its shards are created in it.
+Dispatcher* createDispatcher(Producer** ArrayProducers, Config* config, UnboundedBuffer** DispatcherBuffersArray,
+                             SharedArena* arena) {
     // Allocate memory for a Dispatcher and declare it.
     Dispatcher* dispatcher = malloc(sizeof(Dispatcher));
     dispatcher -> producers = ArrayProducers;
     dispatcher -> TotalNumProducers = config -> TotalNumProducers;
     dispatcher -> DispatcherBuffersArray = DispatcherBuffersArray;
+    dispatcher -> tracing = config -> Tracing;
+    // Its routing table is DispatcherBuffersArray (an article carries the index of its type),
+    // this only decides which of the queues gets its part of a batch first.
+    dispatcher -> typeRanks = malloc(numArticleTypes * sizeof(int));
+    int* order = malloc(numArticleTypes * sizeof(int));
+    if (dispatcher -> typeRanks == NULL || order == NULL) {
+        perror("Failed to allocate memory for Dispatcher");
+        exit(-1);
+    }
+    typePriorityOrder(config, order);
+    for (int i = 0; i < numArticleTypes; ++i) {
+        dispatcher -> typeRanks[order[i]] = i;
+    }
+    free(order);
+    // It waits for the producers buffers, so it waits the same way they do.
+    dispatcher -> waitStrategy = config -> WaitStrategies[QUEUE_PRODUCER];
+    // Split the producers into contiguous slices, one per dispatcher thread (at least one producer each).
+    int numShards = config -> Dispatchers < config -> TotalNumProducers ? config -> Dispatchers : config -> TotalNumProducers;
+    if (numShards < 1) {
+        numShards = 1;
+    }
+    dispatcher -> numShards = numShards;
+    dispatcher -> arena = arena;
+    if (arena != NULL) {
+        dispatcher -> shards = allocateSharedArena(arena, numShards * sizeof(DispatcherShard));
+    } else {
+        dispatcher -> shards = aligned_alloc(CACHE_LINE_SIZE, numShards * sizeof(DispatcherShard));
+    }
+    atomic_init(&dispatcher -> shardsRunning, numShards);
+    int first = 0;
+    for (int s = 0; s < numShards; ++s) {
+        DispatcherShard* shard = &dispatcher -> shards[s];
+        shard -> dispatcher = dispatcher;
+        shard -> index = s;
+        shard -> first = first;
+        shard -> count = config -> TotalNumProducers / numShards + (s < config -> TotalNumProducers % numShards);
+        shard -> doneCount = 0;
+        shard -> byType = malloc(numArticleTypes * DISPATCHER_BATCH * sizeof(Article*));
+        shard -> typeCounts = calloc(numArticleTypes, sizeof(int));
+        shard -> batchTypes = malloc(DISPATCHER_BATCH * sizeof(int));
+        if (shard -> byType == NULL || shard -> typeCounts == NULL || shard -> batchTypes == NULL) {
+            perror("Failed to allocate memory for Dispatcher");
+            exit(-1);
+        }
+        // Empty (no articles yet). Every producer buffer of the shard marks itself in it on insert,
+        // so the shard's thread can sleep until one of them has data (in the arena if they are processes).
+        shard -> readyMembers = malloc((shard -> count + 1) * sizeof(int));
+        if (initReadySet(&shard -> ready, shard -> count, arena) != 0 || shard -> readyMembers == NULL) {
+            exit(-1);
+        }
+        for (int i = first; i < first + shard -> count; ++i) {
+            if (ArrayProducers[i] -> ProducerBuffer != NULL) { // Direct routing has no dispatcher to wake
+                ArrayProducers[i] -> ProducerBuffer -> readySet = &shard -> ready;
+                ArrayProducers[i] -> ProducerBuffer -> readyIndex = i - first;
+            }
+        }
+        first += shard -> count;
+    }
     return dispatcher;
 }
 
 // This function creates a Manager using the provided shared buffer and config.
-Manager* createManager(BoundedBuffer* SharedBuffer, Config* config) {
+Manager* createManager(BoundedBuffer* SharedBuffer, ManagerLanes* lanes, Config* config) {
     // Allocate memory for Struct manager and declare it.
     Manager* manager = malloc(sizeof(Manager));
     manager -> SharedBuffer = SharedBuffer;
+    manager -> lanes = lanes;
+    manager -> writer = constructorOutputWriter(STDOUT_FILENO, config -> OutputFlushBytes, config -> OutputFlushMs);
+    manager -> journal = NULL;
+    if (config -> JournalPath != NULL) {
+        manager -> journal = constructorJournal(config -> JournalPath, config -> JournalSyncMs);
+        if (manager -> journal == NULL) {
+            exit(-1);
+        }
+    }
+    manager -> reorder = NULL;
+    if (config -> ReorderWindow > 0) {
+        int maxProducerId = 0;
+        for (int i = 0; i < config -> TotalNumProducers; ++i) {
+            if (config -> ArrayProducers[i].id > maxProducerId) {
+                maxProducerId = config -> ArrayProducers[i].id;
+            }
+        }
+        manager -> reorder = constructorReorderBuffer(config -> ReorderWindow, config -> ReorderTimeoutMs, maxProducerId,
+                                                      writeManagerArticle, manager);
+        if (manager -> reorder == NULL) {
+            exit(-1);
+        }
+    }
+    manager -> latencies = NULL;
+    manager -> tracer = config -> Tracing ? constructorTracer() : NULL;
     manager -> doneCount = 0;
     manager -> TotalNumProducers = config -> TotalNumProducers;
     return manager;
@@ -1,8 +1,11 @@
 #ifndef TASK3_INITSTRUCTSOBJECTS_H
 #define TASK3_INITSTRUCTSOBJECTS_H
 #include "Structs.h"
-Producer** createProducers(Config* config);
-UnboundedBuffer** createDispatcherBuffers();
-Dispatcher* createDispatcher(Producer** ArrayProducers, Config* config, UnboundedBuffer** DispatcherBuffersArray);
-Manager* createManager(BoundedBuffer* SharedBuffer, Config* config);
+int producerCredits(Config* config);
+size_t producerBlockBytes(Config* config, int i, SharedArena* arena);
+Producer** createProducers(Config* config, SharedArena* arena);
+UnboundedBuffer** createDispatcherBuffers(Config* config);
+Dispatcher* createDispatcher(Producer** ArrayProducers, Config* config, UnboundedBuffer** DispatcherBuffersArray,
+                             SharedArena* arena);
+Manager* createManager(BoundedBuffer* SharedBuffer, ManagerLanes* lanes, Config* config);
 #endif //TASK3_INITSTRUCTSOBJECTS_H
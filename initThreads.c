@@ -1,44 +1,105 @@
 #include "initThreads.h"
 
-// This function creates a thread for each producer
-pthread_t* createProducerThreads(Producer** ArrayProducers, Config* config) {
-    pthread_t* ProducerThreads = malloc(config -> TotalNumProducers * sizeof(pthread_t));
-    for (int i = 0; i < config -> TotalNumProducers; ++i) {
-        // Create a new thread that will execute the producerThread function with the current producer as argument
-        pthread_create(&ProducerThreads[i], NULL, producerThread, ArrayProducers[i]);
+// This function starts the worker threads that run all the producers (see ProducerScheduler.c)
+ProducerScheduler* createProducerWorkers(Producer** ArrayProducers, Config* config, Placement* placement) {
+    return constructorProducerScheduler(ArrayProducers, config -> TotalNumProducers, config -> ProducerWorkers,
+                                        placement);
+}
+
+// This function creates a thread for every shard of the dispatcher
+pthread_t* createDispatcherThreads(Dispatcher* dispatcher, Placement* placement) {
+    pthread_t* dispatcherThreads = malloc(dispatcher -> numShards * sizeof(pthread_t));
+    for (int i = 0; i < dispatcher -> numShards; ++i) {
+        // Create a new thread that will execute the dispatcherThread function with its shard as argument
+        pthread_create(&dispatcherThreads[i], NULL, dispatcherThread, &dispatcher -> shards[i]);
+        placeThread(placement, STAGE_DISPATCHERS, i, dispatcherThreads[i]);
     }
-    return ProducerThreads;
+    return dispatcherThreads;
 }
 
-// This function creates a thread for the dispatcher
-pthread_t createDispatcherThread(Dispatcher* dispatcher) {
-    pthread_t dispatcher_thread_id;
-    // Create a new thread that will execute the dispatcherThread function with the dispatcher as argument
-    pthread_create(&dispatcher_thread_id, NULL, dispatcherThread, dispatcher);
-    return dispatcher_thread_id;
+// Direct routing: split the lanes of the co-editor's type between its threads (producer p goes to thread p % n),
+// and make every lane wake the thread that reads it.
+CoEditorLanes* createCoEditorLanes(CoEditor* coEditor, Producer** producers, int numProducers) {
+    int numWorkers = coEditor -> numWorkers;
+    CoEditorLanes* lanes = malloc(numWorkers * sizeof(CoEditorLanes));
+    for (int j = 0; j < numWorkers; ++j) {
+        lanes[j].coEditor = coEditor;
+        lanes[j].index = j;
+        lanes[j].numLanes = numProducers / numWorkers + (j < numProducers % numWorkers);
+        lanes[j].lanes = malloc((lanes[j].numLanes + 1) * sizeof(BoundedBuffer*));
+        lanes[j].laneDone = calloc(lanes[j].numLanes + 1, sizeof(int));
+        lanes[j].doneCount = 0;
+        lanes[j].readyMembers = malloc((lanes[j].numLanes + 1) * sizeof(int));
+        if (initReadySet(&lanes[j].ready, lanes[j].numLanes, NULL) != 0 || lanes[j].readyMembers == NULL) {
+            exit(-1);
+        }
+    }
+    for (int p = 0; p < numProducers; ++p) {
+        CoEditorLanes* reader = &lanes[p % numWorkers];
+        BoundedBuffer* lane = producers[p] -> lanes[coEditor -> type];
+        reader -> lanes[p / numWorkers] = lane;
+        lane -> readySet = &reader -> ready;
+        lane -> readyIndex = p / numWorkers;
+    }
+    return lanes;
 }
 
-// This function creates a thread for each co-editor
-pthread_t* createCoEditorThreads(Dispatcher* dispatcher, BoundedBuffer* SharedBuffer, CoEditor*** pArrayCoEditors) {
-    // Allocate memory for an array of pthreads and an array of CoEditors
-    pthread_t* coEditorThreads = malloc(NUM_ARTICLES_TYPES * sizeof(pthread_t));
-    CoEditor** ArrayCoEditors = malloc(NUM_ARTICLES_TYPES * sizeof(CoEditor*));
-    for (int i = 0; i < NUM_ARTICLES_TYPES; ++i) {
+// This function creates the co-editor threads, config -> CoEditorWorkers[i] threads for type i.
+// The number of threads created is written to pNumCoEditorThreads.
+pthread_t* createCoEditorThreads(Dispatcher* dispatcher, BoundedBuffer* SharedBuffer, ManagerLanes* managerLanes,
+                                 Config* config, CoEditor*** pArrayCoEditors, int* pNumCoEditorThreads, Placement* placement) {
+    int numThreads = 0;
+    for (int i = 0; i < numArticleTypes; ++i) {
+        numThreads += config -> CoEditorWorkers[i];
+    }
+    // Allocate memory for an array of pthreads and an array of CoEditors (one per type)
+    pthread_t* coEditorThreads = malloc(numThreads * sizeof(pthread_t));
+    CoEditor** ArrayCoEditors = malloc(numArticleTypes * sizeof(CoEditor*));
+    int thread = 0;
+    for (int i = 0; i < numArticleTypes; ++i) {
         ArrayCoEditors[i] = malloc(sizeof(CoEditor));
+        ArrayCoEditors[i] -> type = i;
         ArrayCoEditors[i] -> dispatcherBuffer = dispatcher -> DispatcherBuffersArray[i];
-        ArrayCoEditors[i] -> SharedBuffer = SharedBuffer;
-        // Create a new thread that will execute the coEditorThread function with the current co-editor as argument
-        pthread_create(&coEditorThreads[i], NULL, coEditorThread, ArrayCoEditors[i]);
+        // With lanes to the manager every type writes to its own
+        ArrayCoEditors[i] -> SharedBuffer = managerLanes != NULL ? managerLanes -> lanes[i].buffer : SharedBuffer;
+        ArrayCoEditors[i] -> numWorkers = config -> CoEditorWorkers[i];
+        ArrayCoEditors[i] -> editDelayUsec = config -> EditDelayUsec;
+        ArrayCoEditors[i] -> tracing = config -> Tracing;
+        ArrayCoEditors[i] -> batchSize = config -> EditDelayUsec > 0 ? 1 : COEDITOR_BATCH;
+        // Without a delay there is nothing to wait for, so the async mode would only add bookkeeping.
+        ArrayCoEditors[i] -> maxInFlight = config -> EditDelayUsec > 0 ? config -> AsyncEdits : 0;
+        atomic_init(&ArrayCoEditors[i] -> workersLeft, config -> CoEditorWorkers[i]);
+        ArrayCoEditors[i] -> lanes = NULL;
+        if (config -> DirectRouting) {
+            ArrayCoEditors[i] -> lanes = createCoEditorLanes(ArrayCoEditors[i], dispatcher -> producers,
+                                                             config -> TotalNumProducers);
+            ArrayCoEditors[i] -> maxInFlight = 0; // A thread edits the articles of its lanes one at a time
+        }
+        for (int j = 0; j < config -> CoEditorWorkers[i]; ++j) {
+            // Create a new thread that will execute the coEditorThread (or asyncCoEditorThread) function with the co-editor of its type as argument
+            // (or directCoEditorThread with its own lanes as argument).
+            void* (*run)(void*) = ArrayCoEditors[i] -> maxInFlight > 0 ? asyncCoEditorThread : coEditorThread;
+            void* runArg = ArrayCoEditors[i];
+            if (ArrayCoEditors[i] -> lanes != NULL) {
+                run = directCoEditorThread;
+                runArg = &ArrayCoEditors[i] -> lanes[j];
+            }
+            pthread_create(&coEditorThreads[thread], NULL, run, runArg);
+            placeThread(placement, STAGE_COEDITORS, thread, coEditorThreads[thread]);
+            thread++;
+        }
     }
     *pArrayCoEditors = ArrayCoEditors; // Set the passed pointer to point to ArrayCoEditors
+    *pNumCoEditorThreads = numThreads;
     return coEditorThreads;
 }
 
 // This function creates a thread for the manager
-pthread_t createManagerThread(Manager* manager) {
+pthread_t createManagerThread(Manager* manager, Placement* placement) {
     // Create manager thread
     pthread_t ManagerThreadID;
     // Create a new thread that will execute the managerThread function with the manager as argument
     pthread_create(&ManagerThreadID, NULL, managerThread, manager);
+    placeThread(placement, STAGE_MANAGER, 0, ManagerThreadID);
     return ManagerThreadID;
 }
\ No newline at end of file
@@ -2,8 +2,10 @@
 #ifndef TASK3_INITTHREADS_H
 #define TASK3_INITTHREADS_H
 #include "Structs.h"
-pthread_t* createProducerThreads(Producer** ArrayProducers, Config* config);
-pthread_t createDispatcherThread(Dispatcher* dispatcher);
-pthread_t* createCoEditorThreads(Dispatcher* dispatcher, BoundedBuffer* SharedBuffer, CoEditor*** pArrayCoEditors);
-pthread_t createManagerThread(Manager* manager);
+ProducerScheduler* createProducerWorkers(Producer** ArrayProducers, Config* config, Placement* placement);
+pthread_t* createDispatcherThreads(Dispatcher* dispatcher, Placement* placement);
+CoEditorLanes* createCoEditorLanes(CoEditor* coEditor, Producer** producers, int numProducers);
+pthread_t* createCoEditorThreads(Dispatcher* dispatcher, BoundedBuffer* SharedBuffer, ManagerLanes* managerLanes,
+                                 Config* config, CoEditor*** pArrayCoEditors, int* pNumCoEditorThreads, Placement* placement);
+pthread_t createManagerThread(Manager* manager, Placement* placement);
 #endif //TASK3_INITTHREADS_H
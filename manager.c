@@ -1,23 +1,91 @@
 # include "manager.h"
 
+// Write a single article that came to the manager at 'now' (the arg is the Manager, see Reorder.c).
+void writeManagerArticle(void* arg, Article* article, long long now) {
+    Manager* manager = (Manager*)arg;
+    if (manager -> lanes != NULL) {
+        recordManagerLaneOutput(manager -> lanes, article, now);
+    }
+    if (manager -> latencies != NULL) {
+        recordHistogram(manager -> latencies, now - article -> stamps[STAMP_CREATED]);
+    }
+    if (manager -> tracer != NULL) {
+        article -> stamps[STAMP_OUTPUT] = now;
+        recordArticleTrace(manager -> tracer, article);
+    }
+    // This is the only place an article becomes text.
+    writeArticleOutput(manager -> writer, article);
+    if (manager -> journal != NULL) {
+        appendJournalArticle(manager -> journal, article, now);
+    }
+    // Give the article back to its producer's pool after processing (only if != DONE. DONE is not from a pool.
+    releaseArticle(article);
+}
+
 void* managerThread(void* arg) {
     Manager* manager = (Manager*)arg;
-    char* message;
+    OutputWriter* writer = manager -> writer;
+    Journal* journal = manager -> journal;
+    ReorderBuffer* reorder = manager -> reorder;
+    Article* articles[MANAGER_BATCH];
+    STATS_THREAD_START("manager", 0);
     do {
-        message = removeBoundedBuffer(manager -> SharedBuffer);
-        if (strcmp(message, "DONE") == 0) {
-            manager -> doneCount += 1; // Decrement doneCount for each "DONE" message
-            if (manager -> doneCount == 3) {
-                // Exit the loop when all "DONE" messages have been received
-                break;
+        // Take everything the co-editors already inserted (at least one article) in one go.
+        // If some output is waiting, don't sleep past the time it has to be written.
+        // The same for the journal records that are not msync'ed yet, and for the articles held to be reordered.
+        long long deadline = hasPendingOutput(writer) ? outputFlushDeadline(writer) : 0;
+        if (journal != NULL && hasUnsyncedJournal(journal) && (deadline == 0 || journalSyncDeadline(journal) < deadline)) {
+            deadline = journalSyncDeadline(journal);
+        }
+        if (reorder != NULL && hasHeldArticles(reorder) && (deadline == 0 || reorderDeadline(reorder) < deadline)) {
+            deadline = reorderDeadline(reorder);
+        }
+        int count;
+        if (manager -> lanes != NULL) {
+            count = removeManagerLanesUntil(manager -> lanes, articles, MANAGER_BATCH, deadline);
+        } else {
+            count = removeBoundedBufferBatchUntil(manager -> SharedBuffer, articles, MANAGER_BATCH, deadline);
+        }
+        if (count == 0) {
+            // Nothing came in time, we are idle anyway
+            if (reorder != NULL) {
+                releaseTimedOutArticles(reorder, getMonotonicNs());
+            }
+            flushOutput(writer);
+            if (journal != NULL) {
+                syncJournal(journal);
             }
             continue;
         }
-        printf("%s\n", message);
-        // Free the message after processing (Free it only if != DONE. we send DONE as a literal string.
-        free(message);
-    } while(1);
+        // One clock read for the whole batch, they are all written now.
+        long long now = (manager -> latencies != NULL || manager -> tracer != NULL || journal != NULL ||
+                         manager -> lanes != NULL || reorder != NULL) ? getMonotonicNs() : 0;
+        for (int i = 0; i < count; ++i) {
+            if (isDoneArticle(articles[i])) {
+                manager -> doneCount += 1; // Decrement doneCount for each "DONE" message
+                continue;
+            }
+            if (reorder != NULL) {
+                reorderArticle(reorder, articles[i], now); // Written now, or once the ones before it are
+            } else {
+                writeManagerArticle(manager, articles[i], now);
+            }
+        }
+        if (reorder != NULL) {
+            releaseTimedOutArticles(reorder, now);
+        }
+        if (journal != NULL && hasUnsyncedJournal(journal) && now >= journalSyncDeadline(journal)) {
+            syncJournal(journal);
+        }
+        // Exit the loop when all "DONE" messages have been received (one per type, no matter how many co-editors)
+    } while(manager -> doneCount != numArticleTypes);
+    // Nothing more is coming, so nothing is missing anymore.
+    if (reorder != NULL) {
+        flushReorderBuffer(reorder, getMonotonicNs());
+    }
     // We will add '/n' because in the moodle it allows.
-    printf("DONE\n");
+    writeOutput(writer, "DONE\n", 5);
+    flushOutput(writer);
+    STATS_THREAD_END();
     return NULL;
-}
\ No newline at end of file
+}
@@ -2,5 +2,8 @@
 #ifndef TASK3_MANAGER_H
 #define TASK3_MANAGER_H
 #include "Structs.h"
+// Max number of articles the manager takes from the shared buffer at once.
+#define MANAGER_BATCH 32
+void writeManagerArticle(void* arg, Article* article, long long now);
 void* managerThread(void* arg);
 #endif //TASK3_MANAGER_H